@@ -2,4 +2,7 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     ./src/libVK.pro \
-    example
+    example \
+    benchmark \
+    mockserver \
+    tests
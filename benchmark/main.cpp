@@ -0,0 +1,138 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+/// End-to-end benchmark of the real curl path.
+/// Run it against mockserver:
+///     VKAPI_URL=http://127.0.0.1:8080/method/ VKAPI_AUTH_URL=http://127.0.0.1:8080/ ./benchmark --rps 0
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <stdlib.h>
+
+#include "vkapi.hpp"
+#include "log.hpp"
+
+using namespace std;
+using namespace std::chrono;
+using namespace vk;
+
+struct Options {
+    size_t  requests = 100;
+    size_t  threads  = 1;
+    uint8_t rps      = 3;
+    string  method   = "users.search";
+    string  count    = "100";
+    bool    hedge    = false;
+    string  username = "bench@example.com";
+    string  password = "benchpassword";
+};
+
+struct Result {
+    vector<double>   latencies_ms;
+    map<int, size_t> errors;
+};
+
+static mutex  result_mutex;
+static Result result;
+
+static void worker(const Options& opts, size_t requests) {
+    VKAPI api("3697615", "AlVXZFMUqyrnABp8ncuU");
+    api.SetDefaultAPIVersion("5.45");
+    api.SetMaxRequestsPerSec(opts.rps);
+
+    TimeoutPolicy timeouts;
+    timeouts.SetHedging(opts.hedge);
+    api.SetTimeoutPolicy(timeouts);
+
+    if(const char* url = getenv("VKAPI_URL"))      api.SetAPIUrl(url);
+    if(const char* url = getenv("VKAPI_AUTH_URL")) api.SetAuthUrl(url);
+    if(getenv("VKAPI_INSECURE"))                   api.SetSSLVerifyPeer(false);
+
+    if(const char* token = getenv("VKAPI_TOKEN")) {
+        api.SetDefaultAccessToken(token);
+    } else {
+        api.Authorize(opts.username, opts.password);
+    }
+
+    Result local;
+    for(size_t i = 0; i < requests; i++) {
+        Args args;
+        args["count"]  = opts.count;
+        args["offset"] = to_string(i * atoi(opts.count.c_str()));
+
+        auto start = steady_clock::now();
+        try {
+            api.Request(opts.method, args);
+        } catch(libVKException& e) {
+            local.errors[e.err_code]++;
+        }
+        local.latencies_ms.push_back(duration_cast<microseconds>(steady_clock::now() - start).count() / 1000.0);
+    }
+
+    lock_guard<mutex> lock(result_mutex);
+    result.latencies_ms.insert(result.latencies_ms.end(), local.latencies_ms.begin(), local.latencies_ms.end());
+    for(auto& err : local.errors) result.errors[err.first] += err.second;
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if(sorted.empty()) return 0;
+    size_t idx = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+int main(int argc, char** argv) {
+    mlog::log_level = mlog::warning;
+
+    Options opts;
+    for(int i = 1; i + 1 < argc; i += 2) {
+        string arg = argv[i];
+        string val = argv[i + 1];
+        if     (arg == "--requests") opts.requests = atoll(val.c_str());
+        else if(arg == "--threads")  opts.threads  = atoll(val.c_str());
+        else if(arg == "--rps")      opts.rps      = static_cast<uint8_t>(atoi(val.c_str()));
+        else if(arg == "--method")   opts.method   = val;
+        else if(arg == "--count")    opts.count    = val;
+        else if(arg == "--hedge")    opts.hedge    = val == "1";
+        else {
+            cerr << "Usage: " << argv[0] << " [--requests N] [--threads N] [--rps N] [--method M] [--count N] [--hedge 0|1]" << endl;
+            return 1;
+        }
+    }
+
+    /// rps 0 means unlimited on the client side
+    if(opts.rps == 0) opts.rps = 255;
+
+    auto start = steady_clock::now();
+
+    vector<thread> workers;
+    for(size_t t = 0; t < opts.threads; t++) {
+        size_t share = opts.requests / opts.threads + (t < opts.requests % opts.threads ? 1 : 0);
+        workers.emplace_back(worker, std::cref(opts), share);
+    }
+    for(auto& w : workers) w.join();
+
+    double elapsed = duration_cast<microseconds>(steady_clock::now() - start).count() / 1e6;
+
+    vector<double>& lat = result.latencies_ms;
+    sort(lat.begin(), lat.end());
+
+    cout << "requests:   " << lat.size() << "\n"
+         << "elapsed:    " << elapsed << " s\n"
+         << "throughput: " << lat.size() / elapsed << " req/s\n"
+         << "latency ms: p50 " << percentile(lat, 0.50)
+         << "  p90 "  << percentile(lat, 0.90)
+         << "  p99 "  << percentile(lat, 0.99)
+         << "  max "  << (lat.empty() ? 0 : lat.back()) << "\n";
+
+    for(auto& err : result.errors) {
+        cout << "error " << err.first << ": " << err.second << "\n";
+    }
+
+    return 0;
+}
@@ -34,6 +34,10 @@ int main() {
     /// Create api wrapper instance
     VKAPI api(CLIENT_ID, CLIENT_SECRET);
 
+    /// Endpoints may be redirected at runtime, e.g. to local mockserver
+    if(getenv("VKAPI_URL"))      api.SetAPIUrl(getenv("VKAPI_URL"));
+    if(getenv("VKAPI_AUTH_URL")) api.SetAuthUrl(getenv("VKAPI_AUTH_URL"));
+
     /// Tell VK that we are using version 5.45
     api.SetDefaultAPIVersion("5.45");
 
@@ -0,0 +1 @@
+../src/include/arena.hpp
\ No newline at end of file
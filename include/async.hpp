@@ -0,0 +1 @@
+../src/include/async.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/circuit_breaker.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/columns.hpp
\ No newline at end of file
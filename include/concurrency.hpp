@@ -0,0 +1 @@
+../src/include/concurrency.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/intern.hpp
\ No newline at end of file
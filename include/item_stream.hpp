@@ -0,0 +1 @@
+../src/include/item_stream.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/json_pointer.hpp
\ No newline at end of file
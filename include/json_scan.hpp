@@ -0,0 +1 @@
+../src/include/json_scan.hpp
\ No newline at end of file
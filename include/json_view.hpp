@@ -0,0 +1 @@
+../src/include/json_view.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/quota.hpp
\ No newline at end of file
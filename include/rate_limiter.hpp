@@ -0,0 +1 @@
+../src/include/rate_limiter.hpp
\ No newline at end of file
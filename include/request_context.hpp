@@ -0,0 +1 @@
+../src/include/request_context.hpp
\ No newline at end of file
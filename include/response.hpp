@@ -0,0 +1 @@
+../src/include/response.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/retry.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/sax.hpp
\ No newline at end of file
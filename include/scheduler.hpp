@@ -0,0 +1 @@
+../src/include/scheduler.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/shared_rate_limiter.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/single_flight.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../src/include/timeout.hpp
\ No newline at end of file
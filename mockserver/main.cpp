@@ -0,0 +1,568 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+/// Local mock of api.vk.com / oauth.vk.com for end-to-end load testing.
+///
+/// Serves
+///     /method/<name>?<args>   VK API method call
+///     /token?<args>           oauth password grant
+/// with generated data, configurable latency, VK-style per token rate limiting (error 6)
+/// and error injection. Point libVK at it with VKAPI::SetAPIUrl() / VKAPI::SetAuthUrl(),
+/// e.g. http://127.0.0.1:8080/method/ and http://127.0.0.1:8080/
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <deque>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+
+#include <string.h>
+#include <stdlib.h>
+#include <signal.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include <openssl/ssl.h>
+#include <openssl/err.h>
+
+using namespace std;
+using namespace std::chrono;
+
+struct Config {
+    uint16_t port         = 8080;
+    string   bind_addr    = "127.0.0.1";
+    uint32_t latency_ms   = 0;      ///< Base latency added to every response
+    uint32_t jitter_ms    = 0;      ///< Uniform random latency added on top of the base one
+    double   slow_rate    = 0.0;    ///< Fraction of requests delayed by slow_ms, simulates tail latency
+    uint32_t slow_ms      = 1000;
+    uint32_t max_rps      = 3;      ///< Allowed requests per second per access token, 0 is unlimited
+    double   error_rate   = 0.0;    ///< Fraction of method calls answered with error_code
+    int      error_code   = 10;     ///< VK error code to inject
+    double   drop_rate    = 0.0;    ///< Fraction of requests answered by closing the connection
+    double   flood_rate   = 0.0;    ///< Fraction of method calls answered with error 9
+    string   tls_cert;              ///< PEM certificate, enables HTTPS together with tls_key
+    string   tls_key;
+    bool     verbose      = false;
+};
+
+static Config            config;
+static SSL_CTX*          ssl_ctx = nullptr;
+static atomic<uint64_t>  served(0);
+static atomic<uint64_t>  throttled(0);
+static atomic<uint64_t>  injected(0);
+
+/* ##### Utils ##### */
+
+static string url_decode(const string& str) {
+    string out;
+    out.reserve(str.size());
+    for(size_t i = 0; i < str.size(); i++) {
+        if(str[i] == '%' && i + 2 < str.size()) {
+            out += static_cast<char>(strtol(str.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else if(str[i] == '+') {
+            out += ' ';
+        } else {
+            out += str[i];
+        }
+    }
+    return out;
+}
+
+static map<string, string> parse_query(const string& query) {
+    map<string, string> args;
+    stringstream ss(query);
+    string pair;
+    while(getline(ss, pair, '&')) {
+        size_t eq = pair.find('=');
+        if(eq == string::npos) args[url_decode(pair)] = "";
+        else                   args[url_decode(pair.substr(0, eq))] = url_decode(pair.substr(eq + 1));
+    }
+    return args;
+}
+
+static string json_escape(const string& str) {
+    string out;
+    for(char c : str) {
+        switch(c) {
+        case '"':  out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n";  break;
+        default:   out += c;
+        }
+    }
+    return out;
+}
+
+static vector<long long> parse_ids(const string& list) {
+    vector<long long> ids;
+    stringstream ss(list);
+    string id;
+    while(getline(ss, id, ',')) {
+        if(!id.empty()) ids.push_back(atoll(id.c_str()));
+    }
+    return ids;
+}
+
+static thread_local mt19937_64 rng(random_device{}());
+
+static bool chance(double rate) {
+    if(rate <= 0.0) return false;
+    return uniform_real_distribution<double>(0.0, 1.0)(rng) < rate;
+}
+
+/* ##### Rate limiting ##### */
+
+/// Sliding one second window of request timestamps per access token, like VK does
+class RateLimiter {
+public:
+    bool allow(const string& token) {
+        if(config.max_rps == 0) return true;
+        lock_guard<mutex> lock(mtx);
+        auto  now    = steady_clock::now();
+        auto& window = windows[token];
+        while(!window.empty() && now - window.front() >= seconds(1)) window.pop_front();
+        if(window.size() >= config.max_rps) return false;
+        window.push_back(now);
+        return true;
+    }
+
+private:
+    mutex                                          mtx;
+    map<string, deque<steady_clock::time_point>>  windows;
+};
+
+static RateLimiter limiter;
+
+/* ##### Data generation ##### */
+
+static const char* first_names[] = { "Ivan", "Maria", "Pavel", "Anna", "Dmitry", "Olga", "Sergey", "Elena" };
+static const char* last_names[]  = { "Ivanov", "Petrova", "Sidorov", "Smirnova", "Kuznetsov", "Popova" };
+
+static void gen_user(stringstream& ss, long long id) {
+    mt19937 gen(static_cast<uint32_t>(id));
+    ss << "{\"id\":" << id
+       << ",\"first_name\":\"" << first_names[gen() % 8] << "\""
+       << ",\"last_name\":\""  << last_names[gen() % 6]  << "\""
+       << ",\"sex\":"          << gen() % 3
+       << ",\"bdate\":\""      << 1 + gen() % 28 << "." << 1 + gen() % 12 << "." << 1960 + gen() % 45 << "\""
+       << ",\"city\":{\"id\":" << 1 + gen() % 200 << ",\"title\":\"City\"}"
+       << ",\"online\":"       << gen() % 2
+       << "}";
+}
+
+static void gen_group(stringstream& ss, long long id) {
+    mt19937 gen(static_cast<uint32_t>(id));
+    ss << "{\"id\":" << id
+       << ",\"name\":\"Group " << id << "\""
+       << ",\"screen_name\":\"club" << id << "\""
+       << ",\"is_closed\":" << gen() % 2
+       << ",\"type\":\"group\""
+       << "}";
+}
+
+static void gen_post(stringstream& ss, long long owner_id, long long id) {
+    mt19937 gen(static_cast<uint32_t>(owner_id * 31 + id));
+    ss << "{\"id\":" << id
+       << ",\"owner_id\":" << owner_id
+       << ",\"from_id\":"  << owner_id
+       << ",\"date\":"     << 1450000000 + gen() % 100000000
+       << ",\"text\":\"Post " << id << " text\\nwith \\\"escapes\\\"\""
+       << ",\"likes\":{\"count\":" << gen() % 1000 << "}"
+       << "}";
+}
+
+static size_t get_count(const map<string, string>& args, size_t def, size_t max) {
+    auto it = args.find("count");
+    if(it == args.end()) return def;
+    return min(static_cast<size_t>(atoll(it->second.c_str())), max);
+}
+
+static long long get_offset(const map<string, string>& args) {
+    auto it = args.find("offset");
+    return it == args.end() ? 0 : atoll(it->second.c_str());
+}
+
+static size_t count_execute_calls(const string& code) {
+    size_t calls = 0;
+    for(size_t pos = code.find("API."); pos != string::npos; pos = code.find("API.", pos + 4)) calls++;
+    return max<size_t>(calls, 1);
+}
+
+static void gen_response(stringstream& ss, const string& method, const map<string, string>& args) {
+    const long long offset = get_offset(args);
+
+    if(method == "users.get") {
+        auto ids_it = args.find("user_ids");
+        vector<long long> ids = parse_ids(ids_it == args.end() ? "1" : ids_it->second);
+        ss << "[";
+        for(size_t i = 0; i < ids.size(); i++) {
+            if(i) ss << ",";
+            gen_user(ss, ids[i]);
+        }
+        ss << "]";
+    } else if(method == "users.search") {
+        size_t count = get_count(args, 20, 1000);
+        ss << "{\"count\":" << 1000000 << ",\"items\":[";
+        for(size_t i = 0; i < count; i++) {
+            if(i) ss << ",";
+            gen_user(ss, offset + i + 1);
+        }
+        ss << "]}";
+    } else if(method == "groups.getById") {
+        auto ids_it = args.find("group_ids");
+        if(ids_it == args.end()) ids_it = args.find("group_id");
+        vector<long long> ids = parse_ids(ids_it == args.end() ? "1" : ids_it->second);
+        ss << "[";
+        for(size_t i = 0; i < ids.size(); i++) {
+            if(i) ss << ",";
+            gen_group(ss, ids[i]);
+        }
+        ss << "]";
+    } else if(method == "friends.get" || method == "groups.getMembers" || method == "likes.getList"
+              || method == "users.getFollowers") {
+        size_t count = get_count(args, 100, method == "groups.getMembers" ? 1000 : 5000);
+        ss << "{\"count\":" << 100000 << ",\"items\":[";
+        for(size_t i = 0; i < count; i++) {
+            if(i) ss << ",";
+            ss << offset + i + 1;
+        }
+        ss << "]}";
+    } else if(method == "wall.get") {
+        auto owner_it = args.find("owner_id");
+        long long owner_id = owner_it == args.end() ? 1 : atoll(owner_it->second.c_str());
+        size_t count = get_count(args, 20, 100);
+        ss << "{\"count\":" << 10000 << ",\"items\":[";
+        for(size_t i = 0; i < count; i++) {
+            if(i) ss << ",";
+            gen_post(ss, owner_id, offset + i + 1);
+        }
+        ss << "]}";
+    } else if(method == "utils.getServerTime") {
+        ss << duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+    } else if(method == "execute") {
+        auto code_it = args.find("code");
+        size_t calls = count_execute_calls(code_it == args.end() ? "" : code_it->second);
+        ss << "[";
+        for(size_t i = 0; i < min<size_t>(calls, 25); i++) {
+            if(i) ss << ",";
+            ss << "{\"count\":1000,\"items\":[";
+            for(size_t j = 0; j < 100; j++) {
+                if(j) ss << ",";
+                ss << i * 100 + j + 1;
+            }
+            ss << "]}";
+        }
+        ss << "]";
+    } else {
+        ss << "1";
+    }
+}
+
+static string gen_error(int code, const string& msg, const string& method, const map<string, string>& args) {
+    stringstream ss;
+    ss << "{\"error\":{\"error_code\":" << code
+       << ",\"error_msg\":\"" << json_escape(msg) << "\""
+       << ",\"request_params\":[{\"key\":\"oauth\",\"value\":\"1\"},{\"key\":\"method\",\"value\":\"" << json_escape(method) << "\"}";
+    for(auto& arg : args) {
+        if(arg.first == "access_token") continue;
+        ss << ",{\"key\":\"" << json_escape(arg.first) << "\",\"value\":\"" << json_escape(arg.second) << "\"}";
+    }
+    ss << "]}}";
+    return ss.str();
+}
+
+static string handle_method(const string& method, const map<string, string>& args) {
+    auto token_it = args.find("access_token");
+    const string token = token_it == args.end() ? "" : token_it->second;
+
+    if(!limiter.allow(token)) {
+        throttled++;
+        return gen_error(6, "Too many requests per second", method, args);
+    }
+
+    if(chance(config.flood_rate)) {
+        injected++;
+        return gen_error(9, "Flood control", method, args);
+    }
+
+    if(chance(config.error_rate)) {
+        injected++;
+        return gen_error(config.error_code, "Injected error", method, args);
+    }
+
+    stringstream ss;
+    ss << "{\"response\":";
+    gen_response(ss, method, args);
+    ss << "}";
+    return ss.str();
+}
+
+static string handle_token(const map<string, string>& args) {
+    auto user_it = args.find("username");
+    auto pass_it = args.find("password");
+    if(user_it == args.end() || pass_it == args.end() || pass_it->second.empty()) {
+        return "{\"error\":\"invalid_client\",\"error_description\":\"Username or password is incorrect\"}";
+    }
+
+    stringstream ss;
+    ss << "{\"access_token\":\"mock" << hex << hash<string>()(user_it->second) << dec
+       << "\",\"expires_in\":0,\"user_id\":1}";
+    return ss.str();
+}
+
+/* ##### HTTP ##### */
+
+struct Connection {
+    int  fd  = -1;
+    SSL* ssl = nullptr;
+
+    ssize_t read(char* buf, size_t size) {
+        if(ssl) return SSL_read(ssl, buf, static_cast<int>(size));
+        return ::recv(fd, buf, size, 0);
+    }
+
+    bool write(const string& data) {
+        size_t sent = 0;
+        while(sent < data.size()) {
+            ssize_t n = ssl ? SSL_write(ssl, data.data() + sent, static_cast<int>(data.size() - sent))
+                            : ::send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+            if(n <= 0) return false;
+            sent += n;
+        }
+        return true;
+    }
+
+    void close() {
+        if(ssl) {
+            SSL_shutdown(ssl);
+            SSL_free(ssl);
+        }
+        ::close(fd);
+    }
+};
+
+static string http_response(int status, const string& body, bool keep_alive) {
+    stringstream ss;
+    ss << "HTTP/1.1 " << status << (status == 200 ? " OK" : " Not Found") << "\r\n"
+       << "Content-Type: application/json; charset=utf-8\r\n"
+       << "Content-Length: " << body.size() << "\r\n"
+       << "Connection: " << (keep_alive ? "keep-alive" : "close") << "\r\n"
+       << "\r\n"
+       << body;
+    return ss.str();
+}
+
+static void serve(Connection conn) {
+    if(conn.ssl && SSL_accept(conn.ssl) <= 0) {
+        conn.close();
+        return;
+    }
+
+    string buffer;
+    char   chunk[16384];
+
+    for(;;) {
+        /// Read headers
+        size_t header_end;
+        while((header_end = buffer.find("\r\n\r\n")) == string::npos) {
+            ssize_t n = conn.read(chunk, sizeof(chunk));
+            if(n <= 0) {
+                conn.close();
+                return;
+            }
+            buffer.append(chunk, n);
+        }
+
+        string headers = buffer.substr(0, header_end);
+        buffer.erase(0, header_end + 4);
+
+        string lower = headers;
+        transform(lower.begin(), lower.end(), lower.begin(), ::tolower);
+
+        /// Read body, oauth and method args may come as POST form too
+        size_t content_length = 0;
+        size_t cl_pos = lower.find("content-length:");
+        if(cl_pos != string::npos) content_length = atoll(lower.c_str() + cl_pos + 15);
+        while(buffer.size() < content_length) {
+            ssize_t n = conn.read(chunk, sizeof(chunk));
+            if(n <= 0) {
+                conn.close();
+                return;
+            }
+            buffer.append(chunk, n);
+        }
+        string body = buffer.substr(0, content_length);
+        buffer.erase(0, content_length);
+
+        bool keep_alive = lower.find("connection: close") == string::npos;
+
+        /// Request line: METHOD /path?query HTTP/1.1
+        stringstream request_line(headers.substr(0, headers.find("\r\n")));
+        string verb, target;
+        request_line >> verb >> target;
+
+        size_t qpos  = target.find('?');
+        string path  = target.substr(0, qpos);
+        string query = qpos == string::npos ? "" : target.substr(qpos + 1);
+        if(!body.empty()) query += (query.empty() ? "" : "&") + body;
+        map<string, string> args = parse_query(query);
+
+        if(chance(config.drop_rate)) {
+            injected++;
+            conn.close();
+            return;
+        }
+
+        uint32_t delay = config.latency_ms;
+        if(config.jitter_ms) delay += uniform_int_distribution<uint32_t>(0, config.jitter_ms)(rng);
+        if(chance(config.slow_rate)) delay += config.slow_ms;
+        if(delay) this_thread::sleep_for(milliseconds(delay));
+
+        int    status = 200;
+        string response;
+        if(path.compare(0, 8, "/method/") == 0) {
+            response = handle_method(path.substr(8), args);
+        } else if(path == "/token" || path == "/access_token") {
+            response = handle_token(args);
+        } else {
+            status   = 404;
+            response = "{\"error\":\"not_found\"}";
+        }
+
+        if(config.verbose) cerr << verb << " " << path << " -> " << response.size() << " bytes" << endl;
+
+        served++;
+        if(!conn.write(http_response(status, response, keep_alive)) || !keep_alive) {
+            conn.close();
+            return;
+        }
+    }
+}
+
+/* ##### Main ##### */
+
+static void usage(const char* name) {
+    cerr << "Usage: " << name << " [options]\n"
+         << "  --port N          listen port (8080)\n"
+         << "  --bind ADDR       listen address (127.0.0.1)\n"
+         << "  --latency MS      base response latency (0)\n"
+         << "  --jitter MS       uniform random extra latency (0)\n"
+         << "  --slow-rate F     fraction of requests delayed by --slow-ms (0)\n"
+         << "  --slow-ms MS      tail latency of slow requests (1000)\n"
+         << "  --rps N           allowed requests per second per token, 0 = unlimited (3)\n"
+         << "  --error-rate F    fraction of calls answered with --error-code (0)\n"
+         << "  --error-code N    VK error code to inject (10)\n"
+         << "  --flood-rate F    fraction of calls answered with error 9 (0)\n"
+         << "  --drop-rate F     fraction of requests answered by closing connection (0)\n"
+         << "  --tls-cert FILE   PEM certificate, serve HTTPS\n"
+         << "  --tls-key FILE    PEM private key\n"
+         << "  --verbose         log every request\n";
+}
+
+static bool parse_args(int argc, char** argv) {
+    for(int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if(arg == "--verbose") {
+            config.verbose = true;
+            continue;
+        }
+        if(i + 1 >= argc) return false;
+        string val = argv[++i];
+
+        if     (arg == "--port")       config.port       = static_cast<uint16_t>(atoi(val.c_str()));
+        else if(arg == "--bind")       config.bind_addr  = val;
+        else if(arg == "--latency")    config.latency_ms = atoi(val.c_str());
+        else if(arg == "--jitter")     config.jitter_ms  = atoi(val.c_str());
+        else if(arg == "--slow-rate")  config.slow_rate  = atof(val.c_str());
+        else if(arg == "--slow-ms")    config.slow_ms    = atoi(val.c_str());
+        else if(arg == "--rps")        config.max_rps    = atoi(val.c_str());
+        else if(arg == "--error-rate") config.error_rate = atof(val.c_str());
+        else if(arg == "--error-code") config.error_code = atoi(val.c_str());
+        else if(arg == "--flood-rate") config.flood_rate = atof(val.c_str());
+        else if(arg == "--drop-rate")  config.drop_rate  = atof(val.c_str());
+        else if(arg == "--tls-cert")   config.tls_cert   = val;
+        else if(arg == "--tls-key")    config.tls_key    = val;
+        else return false;
+    }
+    return true;
+}
+
+static bool init_tls() {
+    SSL_library_init();
+    SSL_load_error_strings();
+    ssl_ctx = SSL_CTX_new(SSLv23_server_method());
+    if(!ssl_ctx
+       || SSL_CTX_use_certificate_file(ssl_ctx, config.tls_cert.c_str(), SSL_FILETYPE_PEM) <= 0
+       || SSL_CTX_use_PrivateKey_file(ssl_ctx, config.tls_key.c_str(), SSL_FILETYPE_PEM) <= 0) {
+        ERR_print_errors_fp(stderr);
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv) {
+    if(!parse_args(argc, argv)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    if(!config.tls_cert.empty() && !init_tls()) {
+        return 1;
+    }
+
+    int listen_fd = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port   = htons(config.port);
+    inet_pton(AF_INET, config.bind_addr.c_str(), &addr.sin_addr);
+
+    if(bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd, 1024) < 0) {
+        perror("bind/listen");
+        return 1;
+    }
+
+    /// Periodic stats
+    thread([]() {
+        uint64_t last = 0;
+        for(;;) {
+            this_thread::sleep_for(seconds(10));
+            if(served == last) continue;
+            last = served;
+            cerr << "served: " << served << ", throttled: " << throttled << ", injected errors: " << injected << endl;
+        }
+    }).detach();
+
+    cerr << "mockserver listening on " << (ssl_ctx ? "https://" : "http://")
+         << config.bind_addr << ":" << config.port << "/" << endl;
+
+    for(;;) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if(fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Connection conn;
+        conn.fd = fd;
+        if(ssl_ctx) {
+            conn.ssl = SSL_new(ssl_ctx);
+            SSL_set_fd(conn.ssl, fd);
+        }
+        thread(serve, conn).detach();
+    }
+}
@@ -0,0 +1,12 @@
+# Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+# See LICENSE
+
+TEMPLATE = app
+CONFIG += console c++11 thread
+CONFIG -= app_bundle
+CONFIG -= qt
+
+TARGET = mockserver
+
+SOURCES += main.cpp
+LIBS += -lssl -lcrypto -lpthread
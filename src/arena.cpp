@@ -0,0 +1,394 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "arena.hpp"
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <new>
+
+namespace vk {
+
+/// New blocks double in size up to this
+#define ARENA_MAX_BLOCK (4 * 1024 * 1024)
+
+/* ##### Arena ##### */
+
+Arena::Arena(size_t block_size)
+    : block_size(block_size ? block_size : 1), current(0), ptr(nullptr), end(nullptr), used(0) {}
+
+Arena::~Arena() {
+    Release();
+}
+
+void*
+Arena::Allocate(size_t size, size_t align) {
+    char* aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t)(align - 1));
+    if(!ptr || aligned + size > end) {
+        if(!NextBlock(size, align)) throw std::bad_alloc();
+        aligned = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(ptr) + align - 1) & ~(uintptr_t)(align - 1));
+    }
+    ptr = aligned + size;
+    return aligned;
+}
+
+bool
+Arena::NextBlock(size_t size, size_t align) {
+    if(ptr) used += ptr - blocks[current].data;
+
+    /// Reuse blocks left from before Reset() while they fit
+    size_t next = ptr ? current + 1 : current;
+    while(next < blocks.size() && blocks[next].size < size + align) next++;
+
+    if(next == blocks.size()) {
+        Block block;
+        block.size = (size + align > block_size) ? size + align : block_size;
+        block.data = static_cast<char*>(malloc(block.size));
+        if(!block.data) return false;
+        blocks.push_back(block);
+        if(block_size < ARENA_MAX_BLOCK) block_size *= 2;
+    }
+
+    current = next;
+    ptr     = blocks[current].data;
+    end     = ptr + blocks[current].size;
+    return true;
+}
+
+const char*
+Arena::Copy(StringRef str) {
+    char* copy = static_cast<char*>(Allocate(str.size, 1));
+    memcpy(copy, str.data, str.size);
+    return copy;
+}
+
+void
+Arena::Reset() {
+    current = 0;
+    used    = 0;
+    ptr     = blocks.empty() ? nullptr : blocks[0].data;
+    end     = blocks.empty() ? nullptr : blocks[0].data + blocks[0].size;
+}
+
+void
+Arena::Release() {
+    for(auto& block : blocks) free(block.data);
+    blocks.clear();
+    current = 0;
+    used    = 0;
+    ptr     = nullptr;
+    end     = nullptr;
+}
+
+size_t
+Arena::getUsed() const {
+    return used + (ptr ? ptr - blocks[current].data : 0);
+}
+
+size_t
+Arena::getCapacity() const {
+    size_t capacity = 0;
+    for(auto& block : blocks) capacity += block.size;
+    return capacity;
+}
+
+/* ##### ArenaValue ##### */
+
+JsonView::Type
+ArenaValue::type() const {
+    if(!node) return JsonView::MISSING;
+
+    switch(node->kind) {
+    case ArenaNode::NODE_NULL:   return JsonView::NULL_VALUE;
+    case ArenaNode::NODE_BOOL:   return JsonView::BOOL;
+    case ArenaNode::NODE_STRING: return JsonView::STRING;
+    case ArenaNode::NODE_ARRAY:  return JsonView::ARRAY;
+    case ArenaNode::NODE_OBJECT: return JsonView::OBJECT;
+    default:                     return JsonView::NUMBER;
+    }
+}
+
+ArenaValue
+ArenaValue::operator[](StringRef key) const {
+    if(!isObject()) return ArenaValue();
+
+    /// Known names are always stored interned, one pointer compare per member
+    const StringRef known = KeyTable::Known(key);
+    if(known.data) {
+        for(uint32_t i = 0; i < node->size; i++) {
+            if(node->children[i].key == known.data) return ArenaValue(&node->children[i]);
+        }
+        return ArenaValue();
+    }
+
+    for(uint32_t i = 0; i < node->size; i++) {
+        const ArenaNode& member = node->children[i];
+        if(StringRef(member.key, member.key_size) == key) return ArenaValue(&member);
+    }
+    return ArenaValue();
+}
+
+ArenaValue
+ArenaValue::operator[](size_t index) const {
+    if(!isArray() || index >= node->size) return ArenaValue();
+    return ArenaValue(&node->children[index]);
+}
+
+size_t
+ArenaValue::size() const {
+    return (isArray() || isObject()) ? node->size : 0;
+}
+
+ArenaValue::Iterator
+ArenaValue::begin() const {
+    return Iterator(size() ? node->children : nullptr);
+}
+
+ArenaValue::Iterator
+ArenaValue::end() const {
+    return Iterator(size() ? node->children + node->size : nullptr);
+}
+
+bool
+ArenaValue::asBool(bool def) const {
+    return isBool() ? node->boolean : def;
+}
+
+int
+ArenaValue::asInt(int def) const {
+    int64_t value = asInt64(def);
+    return (value < INT_MIN || value > INT_MAX) ? def : static_cast<int>(value);
+}
+
+int64_t
+ArenaValue::asInt64(int64_t def) const {
+    if(!node) return def;
+
+    switch(node->kind) {
+    case ArenaNode::NODE_INT:    return node->int64;
+    case ArenaNode::NODE_UINT:   return node->uint64 > static_cast<uint64_t>(INT64_MAX) ? def : static_cast<int64_t>(node->uint64);
+    case ArenaNode::NODE_DOUBLE:
+        /// Casting an out of range double is undefined
+        return (node->real >= -9223372036854775808.0 && node->real < 9223372036854775808.0)
+             ? static_cast<int64_t>(node->real) : def;
+    default:                     return def;
+    }
+}
+
+uint64_t
+ArenaValue::asUInt64(uint64_t def) const {
+    if(!node) return def;
+
+    switch(node->kind) {
+    case ArenaNode::NODE_INT:    return node->int64 < 0 ? def : static_cast<uint64_t>(node->int64);
+    case ArenaNode::NODE_UINT:   return node->uint64;
+    case ArenaNode::NODE_DOUBLE:
+        return (node->real >= 0 && node->real < 18446744073709551616.0) ? static_cast<uint64_t>(node->real) : def;
+    default:                     return def;
+    }
+}
+
+ID
+ArenaValue::asID(ID def) const {
+    return (node && node->kind == ArenaNode::NODE_INT) ? node->int64 : asInt64(def);
+}
+
+double
+ArenaValue::asDouble(double def) const {
+    if(!node) return def;
+
+    switch(node->kind) {
+    case ArenaNode::NODE_INT:    return static_cast<double>(node->int64);
+    case ArenaNode::NODE_UINT:   return static_cast<double>(node->uint64);
+    case ArenaNode::NODE_DOUBLE: return node->real;
+    default:                     return def;
+    }
+}
+
+string
+ArenaValue::asString(const string& def) const {
+    return isString() ? string(node->str, node->size) : def;
+}
+
+StringRef
+ArenaValue::getString() const {
+    return isString() ? StringRef(node->str, node->size) : StringRef();
+}
+
+StringRef
+ArenaValue::key() const {
+    return (node && node->key) ? StringRef(node->key, node->key_size) : StringRef();
+}
+
+VKValue
+ArenaValue::toValue() const {
+    if(!node) return VKValue();
+
+    switch(node->kind) {
+    case ArenaNode::NODE_BOOL:   return VKValue(node->boolean);
+    case ArenaNode::NODE_INT:
+        /// Json::Reader keeps positive values above maxInt unsigned, so do the same for equal values
+        if(node->int64 > Json::Value::maxInt) return VKValue(static_cast<Json::UInt64>(node->int64));
+        return VKValue(static_cast<Json::Int64>(node->int64));
+    case ArenaNode::NODE_UINT:   return VKValue(static_cast<Json::UInt64>(node->uint64));
+    case ArenaNode::NODE_DOUBLE: return VKValue(node->real);
+    case ArenaNode::NODE_STRING: return VKValue(node->str, node->str + node->size);
+    case ArenaNode::NODE_ARRAY: {
+        VKValue array(Json::arrayValue);
+        for(ArenaValue element : *this) array.append(element.toValue());
+        return array;
+    }
+    case ArenaNode::NODE_OBJECT: {
+        VKValue object(Json::objectValue);
+        for(Iterator it = begin(), last = end(); it != last; ++it) object[it.key().str()] = (*it).toValue();
+        return object;
+    }
+    default:                     return VKValue();
+    }
+}
+
+/* ##### ArenaDocument ##### */
+
+ArenaDocument::ArenaDocument(size_t block_size)
+    : arena(block_size), key(nullptr), key_size(0), complete(false) {}
+
+bool
+ArenaDocument::Parse(const char* data, size_t size) {
+    Clear();
+
+    string message;
+    if(!JsonPushParser::Parse(data, size, *this, &message) && !message.empty()) {
+        Clear();
+        error = message;
+        return false;
+    }
+    return true;
+}
+
+bool
+ArenaDocument::Parse(const string& text) {
+    return Parse(text.data(), text.size());
+}
+
+void
+ArenaDocument::Clear() {
+    arena.Reset();
+    scratch.clear();
+    frames.clear();
+    key      = nullptr;
+    key_size = 0;
+    complete = false;
+    error.clear();
+}
+
+ArenaValue
+ArenaDocument::getRoot() const {
+    return complete ? ArenaValue(&root) : ArenaValue();
+}
+
+const Arena&
+ArenaDocument::getArena() const {
+    return arena;
+}
+
+const KeyTable&
+ArenaDocument::getKeys() const {
+    return keys;
+}
+
+const string&
+ArenaDocument::getError() const {
+    return error;
+}
+
+ArenaNode&
+ArenaDocument::Add(ArenaNode::Kind kind) {
+    /// A value after a finished document begins the next one
+    if(complete) Clear();
+
+    ArenaNode* node;
+    if(frames.empty()) {
+        node = &root;
+        complete = true;
+    } else {
+        scratch.push_back(ArenaNode());
+        node = &scratch.back();
+    }
+
+    node->key      = key;
+    node->key_size = key_size;
+    node->kind     = kind;
+    node->size     = 0;
+    key      = nullptr;
+    key_size = 0;
+    return *node;
+}
+
+bool
+ArenaDocument::Start() {
+    if(complete) Clear();
+
+    Frame frame;
+    frame.first    = scratch.size();
+    frame.key      = key;
+    frame.key_size = key_size;
+    frames.push_back(frame);
+
+    key      = nullptr;
+    key_size = 0;
+    return true;
+}
+
+bool
+ArenaDocument::End(ArenaNode::Kind kind) {
+    const Frame frame = frames.back();
+    const size_t count = scratch.size() - frame.first;
+
+    /// Children move from the scratch stack into one arena array
+    ArenaNode* children = nullptr;
+    if(count) {
+        children = static_cast<ArenaNode*>(arena.Allocate(count * sizeof(ArenaNode), alignof(ArenaNode)));
+        memcpy(children, &scratch[frame.first], count * sizeof(ArenaNode));
+    }
+    scratch.resize(frame.first);
+    frames.pop_back();
+
+    key      = frame.key;
+    key_size = frame.key_size;
+    ArenaNode& node = Add(kind);
+    node.size     = count;
+    node.children = children;
+    return true;
+}
+
+bool ArenaDocument::Null()               { Add(ArenaNode::NODE_NULL);                          return true; }
+bool ArenaDocument::Bool(bool value)     { Add(ArenaNode::NODE_BOOL).boolean  = value;         return true; }
+bool ArenaDocument::Int64(int64_t value) { Add(ArenaNode::NODE_INT).int64     = value;         return true; }
+bool ArenaDocument::Uint64(uint64_t value) { Add(ArenaNode::NODE_UINT).uint64 = value;         return true; }
+bool ArenaDocument::Double(double value) { Add(ArenaNode::NODE_DOUBLE).real   = value;         return true; }
+bool ArenaDocument::StartObject()        { return Start(); }
+bool ArenaDocument::StartArray()         { return Start(); }
+bool ArenaDocument::EndObject()          { return End(ArenaNode::NODE_OBJECT); }
+bool ArenaDocument::EndArray()           { return End(ArenaNode::NODE_ARRAY); }
+
+bool
+ArenaDocument::String(StringRef value) {
+    /// Clear before copying, not in Add() after it
+    if(complete) Clear();
+
+    const char* copy = arena.Copy(value);
+    ArenaNode& node = Add(ArenaNode::NODE_STRING);
+    node.str  = copy;
+    node.size = value.size;
+    return true;
+}
+
+bool
+ArenaDocument::Key(StringRef name) {
+    const StringRef interned = keys.Intern(name);
+    key      = interned.data ? interned.data : arena.Copy(name);
+    key_size = name.size;
+    return true;
+}
+
+}
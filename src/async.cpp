@@ -0,0 +1,79 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "async.hpp"
+#include "log.hpp"
+
+namespace vk {
+
+AsyncPool::AsyncPool(size_t workers, const Setup& setup, const std::shared_ptr<ConcurrencyController>& controller)
+    : stopping(false), controller(controller) {
+    /// Configure every api before starting any thread, so setup errors reach the caller
+    for(size_t i = 0; i < workers; i++) {
+        apis.emplace_back(new VKAPI());
+        if(setup) setup(*apis.back());
+        apis.back()->SetConcurrencyController(controller);
+    }
+    for(auto& api : apis) {
+        threads.emplace_back(&AsyncPool::Worker, this, api.get());
+    }
+    LOG2() << "async pool started with " << workers << " workers";
+}
+
+AsyncPool::~AsyncPool() {
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        stopping = true;
+    }
+    cv.notify_all();
+    for(auto& thread : threads) thread.join();
+}
+
+std::future<VKValue>
+AsyncPool::Submit(const string& method, const Args& arguments, const RequestContext& ctx) {
+    std::unique_ptr<Job> job(new Job);
+    job->method    = method;
+    job->arguments = arguments;
+    job->ctx       = ctx;
+    std::future<VKValue> future = job->promise.get_future();
+
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        jobs.push_back(std::move(job));
+    }
+    cv.notify_one();
+    return future;
+}
+
+void
+AsyncPool::Worker(VKAPI* api) {
+    for(;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [this] { return stopping || !jobs.empty(); });
+            if(jobs.empty()) return;
+            job = std::move(jobs.front());
+            jobs.pop_front();
+        }
+
+        try {
+            job->promise.set_value(api->Request(job->method, job->arguments, job->ctx));
+        } catch(...) {
+            job->promise.set_exception(std::current_exception());
+        }
+    }
+}
+
+size_t
+AsyncPool::getPending() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return jobs.size();
+}
+
+const std::shared_ptr<ConcurrencyController>&
+AsyncPool::getController() const {
+    return controller;
+}
+
+}
@@ -0,0 +1,197 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "circuit_breaker.hpp"
+#include "log.hpp"
+
+namespace vk {
+
+/* ##### CircuitBreaker ##### */
+
+CircuitBreaker::CircuitBreaker(const CircuitBreakerSettings& settings)
+    : settings(settings), state(CLOSED), next(0), failures(0), slow_calls(0),
+      trials_left(0), trials_ok(0) {}
+
+bool
+CircuitBreaker::Allow(bool* trial) {
+    if(trial) *trial = false;
+    if(state == CLOSED) return true;
+
+    if(state == OPEN) {
+        if(steady_clock::now() - opened_at < settings.open_duration) return false;
+        state       = HALF_OPEN;
+        trials_left = settings.half_open_calls;
+        trials_ok   = 0;
+    }
+
+    if(trials_left == 0) return false;
+    trials_left--;
+    if(trial) *trial = true;
+    return true;
+}
+
+void
+CircuitBreaker::OnSuccess(milliseconds latency) {
+    const bool slow = latency >= settings.slow_call;
+
+    if(state == HALF_OPEN) {
+        if(slow) {
+            Trip();
+        } else if(++trials_ok >= settings.half_open_calls) {
+            Reset();
+        }
+        return;
+    }
+
+    if(state == CLOSED) Push(false, slow);
+}
+
+void
+CircuitBreaker::OnFailure() {
+    if(state == HALF_OPEN) {
+        Trip();
+        return;
+    }
+
+    if(state == CLOSED) Push(true, false);
+}
+
+void
+CircuitBreaker::Release(bool trial) {
+    /// Slot of an earlier half-open period isn't one of the current period's
+    if(trial && state == HALF_OPEN && trials_left < settings.half_open_calls) trials_left++;
+}
+
+CircuitBreaker::State
+CircuitBreaker::getState() const {
+    return state;
+}
+
+void
+CircuitBreaker::Push(bool failure, bool slow) {
+    const uint8_t outcome = (failure ? 1 : 0) | (slow ? 2 : 0);
+
+    if(outcomes.size() < settings.window) {
+        outcomes.push_back(outcome);
+    } else {
+        failures   -= outcomes[next] & 1;
+        slow_calls -= (outcomes[next] >> 1) & 1;
+        outcomes[next] = outcome;
+        next = (next + 1) % settings.window;
+    }
+    failures   += failure;
+    slow_calls += slow;
+
+    const size_t count = outcomes.size();
+    if(count < settings.min_calls) return;
+
+    if(failures   >= settings.error_ratio * count
+    || slow_calls >= settings.slow_ratio  * count) {
+        Trip();
+    }
+}
+
+void
+CircuitBreaker::Trip() {
+    state     = OPEN;
+    opened_at = steady_clock::now();
+}
+
+void
+CircuitBreaker::Reset() {
+    state      = CLOSED;
+    next       = 0;
+    failures   = 0;
+    slow_calls = 0;
+    outcomes.clear();
+}
+
+/* ##### CircuitBreakerGroup ##### */
+
+CircuitBreakerGroup::CircuitBreakerGroup(const CircuitBreakerSettings& settings)
+    : settings(settings) {}
+
+CircuitBreaker&
+CircuitBreakerGroup::Breaker(map<string, CircuitBreaker>& breakers, const string& key) {
+    auto it = breakers.find(key);
+    if(it == breakers.end()) {
+        it = breakers.insert(std::make_pair(key, CircuitBreaker(settings))).first;
+    }
+    return it->second;
+}
+
+bool
+CircuitBreakerGroup::Allow(const string& host, const string& method, CircuitBreakerPermit& permit) {
+    std::lock_guard<std::mutex> lock(mtx);
+    permit = CircuitBreakerPermit();
+
+    CircuitBreaker& host_breaker = Breaker(hosts, host);
+    if(!host_breaker.Allow(&permit.host_trial)) return false;
+
+    if(!Breaker(methods, method).Allow(&permit.method_trial)) {
+        host_breaker.Release(permit.host_trial);
+        permit = CircuitBreakerPermit();
+        return false;
+    }
+    return true;
+}
+
+void
+CircuitBreakerGroup::Success(const string& host, const string& method, milliseconds latency) {
+    std::lock_guard<std::mutex> lock(mtx);
+    CircuitBreaker& host_breaker   = Breaker(hosts, host);
+    CircuitBreaker& method_breaker = Breaker(methods, method);
+
+    const bool was_closed = method_breaker.getState() == CircuitBreaker::CLOSED;
+    host_breaker.OnSuccess(latency);
+    method_breaker.OnSuccess(latency);
+
+    if(!was_closed && method_breaker.getState() == CircuitBreaker::CLOSED) {
+        INFO() << "circuit for " << method << " is closed again";
+    }
+}
+
+void
+CircuitBreakerGroup::Failure(const string& host, const string& method, milliseconds latency, bool transport) {
+    std::lock_guard<std::mutex> lock(mtx);
+    CircuitBreaker& host_breaker   = Breaker(hosts, host);
+    CircuitBreaker& method_breaker = Breaker(methods, method);
+
+    const bool host_open   = host_breaker.getState()   == CircuitBreaker::OPEN;
+    const bool method_open = method_breaker.getState() == CircuitBreaker::OPEN;
+
+    /// Host that answered with an API error is alive, only the method is in trouble
+    if(transport) host_breaker.OnFailure();
+    else          host_breaker.OnSuccess(latency);
+    method_breaker.OnFailure();
+
+    if(!host_open && host_breaker.getState() == CircuitBreaker::OPEN) {
+        WARNING() << "circuit for host " << host << " is open";
+    }
+    if(!method_open && method_breaker.getState() == CircuitBreaker::OPEN) {
+        WARNING() << "circuit for " << method << " is open";
+    }
+}
+
+void
+CircuitBreakerGroup::Release(const string& host, const string& method, const CircuitBreakerPermit& permit) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Breaker(hosts, host).Release(permit.host_trial);
+    Breaker(methods, method).Release(permit.method_trial);
+}
+
+CircuitBreaker::State
+CircuitBreakerGroup::getHostState(const string& host) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = hosts.find(host);
+    return it == hosts.end() ? CircuitBreaker::CLOSED : it->second.getState();
+}
+
+CircuitBreaker::State
+CircuitBreakerGroup::getMethodState(const string& method) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = methods.find(method);
+    return it == methods.end() ? CircuitBreaker::CLOSED : it->second.getState();
+}
+
+}
@@ -0,0 +1,121 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "columns.hpp"
+
+namespace vk {
+
+ColumnSet::ColumnSet() : rows(0) {}
+
+size_t
+ColumnSet::AddColumn(const string& path, ColumnType type) {
+    Column column;
+    column.type = type;
+
+    size_t begin = 0;
+    for(;;) {
+        size_t dot = path.find('.', begin);
+        column.path.push_back(path.substr(begin, dot == string::npos ? string::npos : dot - begin));
+        if(dot == string::npos) break;
+        begin = dot + 1;
+    }
+
+    /// Rows appended before the column was added get defaults
+    column.ids.resize(type == COLUMN_ID ? rows : 0);
+    column.ints.resize(type == COLUMN_INT ? rows : 0);
+    column.doubles.resize(type == COLUMN_DOUBLE ? rows : 0);
+    column.offsets.assign(type == COLUMN_STRING ? rows + 1 : 1, 0);
+
+    columns.push_back(std::move(column));
+    return columns.size() - 1;
+}
+
+void
+ColumnSet::Append(const ArenaValue& item) {
+    for(Column& column : columns) {
+        ArenaValue value = item;
+        for(const string& name : column.path) value = value[StringRef(name)];
+
+        switch(column.type) {
+        case COLUMN_ID:     column.ids.push_back(value.asID());         break;
+        case COLUMN_INT:    column.ints.push_back(value.asInt());       break;
+        case COLUMN_DOUBLE: column.doubles.push_back(value.asDouble()); break;
+        case COLUMN_STRING: {
+            StringRef str = value.getString();
+            column.chars.append(str.data, str.size);
+            column.offsets.push_back(column.chars.size());
+            break;
+        }
+        }
+    }
+    rows++;
+}
+
+void
+ColumnSet::Clear() {
+    for(Column& column : columns) {
+        column.ids.clear();
+        column.ints.clear();
+        column.doubles.clear();
+        column.chars.clear();
+        column.offsets.assign(1, 0);
+    }
+    rows = 0;
+}
+
+void
+ColumnSet::Truncate(size_t rows) {
+    if(rows >= this->rows) return;
+
+    for(Column& column : columns) {
+        switch(column.type) {
+        case COLUMN_ID:     column.ids.resize(rows);     break;
+        case COLUMN_INT:    column.ints.resize(rows);    break;
+        case COLUMN_DOUBLE: column.doubles.resize(rows); break;
+        case COLUMN_STRING:
+            column.offsets.resize(rows + 1);
+            column.chars.resize(column.offsets[rows]);
+            break;
+        }
+    }
+    this->rows = rows;
+}
+
+size_t
+ColumnSet::getRows() const {
+    return rows;
+}
+
+size_t
+ColumnSet::getColumns() const {
+    return columns.size();
+}
+
+const IDArray&
+ColumnSet::getIDs(size_t column) const {
+    return columns.at(column).ids;
+}
+
+const vector<int>&
+ColumnSet::getInts(size_t column) const {
+    return columns.at(column).ints;
+}
+
+const vector<double>&
+ColumnSet::getDoubles(size_t column) const {
+    return columns.at(column).doubles;
+}
+
+StringRef
+ColumnSet::getString(size_t column, size_t row) const {
+    const Column& c = columns.at(column);
+    if(c.type != COLUMN_STRING || row >= rows) return StringRef();
+    return StringRef(c.chars.data() + c.offsets[row], c.offsets[row + 1] - c.offsets[row]);
+}
+
+ItemStream::Callback
+ColumnSet::Collector() {
+    return [this](const ArenaValue& item) { Append(item); };
+}
+
+}
@@ -0,0 +1,156 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "concurrency.hpp"
+#include "vkapi.hpp"
+#include "log.hpp"
+#include <algorithm>
+
+namespace vk {
+
+/* ##### ConcurrencyLimiter ##### */
+
+ConcurrencyLimiter::ConcurrencyLimiter(const ConcurrencySettings& settings)
+    : settings(settings), in_flight(0), no_load(0), samples(0), increases(0), decreases(0) {
+    limit = std::min(std::max(settings.initial_limit, settings.min_limit), settings.max_limit);
+}
+
+void
+ConcurrencyLimiter::Acquire(const RequestContext& ctx) {
+    std::unique_lock<std::mutex> lock(mtx);
+    while(in_flight >= limit) {
+        if(ctx.isCancelled()) throw CancelledException("request cancelled while waiting for concurrency limit");
+        if(ctx.isExpired())   throw DeadlineException("request deadline exceeded while waiting for concurrency limit");
+
+        steady_clock::time_point wake = steady_clock::now() + VKAPI_CANCEL_POLL_INTERVAL;
+        if(ctx.hasDeadline()) wake = std::min(wake, ctx.getDeadline());
+        cv.wait_until(lock, wake);
+    }
+    in_flight++;
+}
+
+bool
+ConcurrencyLimiter::TryAcquire() {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(in_flight >= limit) return false;
+    in_flight++;
+    return true;
+}
+
+void
+ConcurrencyLimiter::Release(milliseconds latency, bool dropped) {
+    std::lock_guard<std::mutex> lock(mtx);
+    in_flight--;
+    cv.notify_one();
+
+    if(dropped) {
+        SetLimit(static_cast<size_t>(limit * settings.backoff), "dropped call");
+        return;
+    }
+
+    latency = std::max(latency, milliseconds(1));
+
+    /// Forget the best latency from time to time, it drifts with network and VK load
+    const bool probe = settings.probe_interval && ++samples % settings.probe_interval == 0;
+    if(probe || no_load.count() == 0 || latency < no_load) {
+        no_load = latency;
+    }
+
+    const double gradient = static_cast<double>(no_load.count()) / latency.count();
+    const double queue    = limit * (1.0 - gradient);
+
+    if(queue < settings.alpha) {
+        /// Don't grow a limit callers don't even reach
+        if((in_flight + 1) * 2 >= limit) SetLimit(limit + 1, "latency is flat");
+    } else if(queue > settings.beta) {
+        SetLimit(limit - 1, "latency grows");
+    }
+}
+
+void
+ConcurrencyLimiter::Release() {
+    std::lock_guard<std::mutex> lock(mtx);
+    in_flight--;
+    cv.notify_one();
+}
+
+void
+ConcurrencyLimiter::SetLimit(size_t new_limit, const char* reason) {
+    new_limit = std::min(std::max(new_limit, settings.min_limit), settings.max_limit);
+    if(new_limit == limit) return;
+
+    if(new_limit > limit) {
+        increases++;
+        cv.notify_all();
+    } else {
+        decreases++;
+    }
+    LOG3() << reason << ", concurrency limit " << limit << " -> " << new_limit;
+    limit = new_limit;
+}
+
+size_t
+ConcurrencyLimiter::getLimit() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return limit;
+}
+
+size_t
+ConcurrencyLimiter::getInFlight() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return in_flight;
+}
+
+milliseconds
+ConcurrencyLimiter::getNoLoadLatency() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return no_load;
+}
+
+uint64_t
+ConcurrencyLimiter::getIncreases() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return increases;
+}
+
+uint64_t
+ConcurrencyLimiter::getDecreases() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return decreases;
+}
+
+/* ##### ConcurrencyController ##### */
+
+ConcurrencyController::ConcurrencyController(const ConcurrencySettings& settings)
+    : settings(settings) {}
+
+ConcurrencyLimiter&
+ConcurrencyController::getLimiter(const string& host) {
+    std::lock_guard<std::mutex> lock(mtx);
+    std::unique_ptr<ConcurrencyLimiter>& limiter = limiters[host];
+    if(!limiter) limiter.reset(new ConcurrencyLimiter(settings));
+    /// Limiters are never removed, the reference stays valid
+    return *limiter;
+}
+
+void
+ConcurrencyController::Acquire(const string& host, const RequestContext& ctx) {
+    getLimiter(host).Acquire(ctx);
+}
+
+bool
+ConcurrencyController::TryAcquire(const string& host) {
+    return getLimiter(host).TryAcquire();
+}
+
+void
+ConcurrencyController::Release(const string& host, milliseconds latency, bool dropped) {
+    getLimiter(host).Release(latency, dropped);
+}
+
+void
+ConcurrencyController::Release(const string& host) {
+    getLimiter(host).Release();
+}
+
+}
@@ -0,0 +1,190 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_ARENA_HPP
+#define VKAPI_ARENA_HPP
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "types.hpp"
+#include "sax.hpp"
+#include "json_view.hpp"
+#include "intern.hpp"
+
+namespace vk {
+
+/// Monotonic allocator: allocation bumps a pointer, nothing is freed one by one.
+/// Reset() rewinds over the blocks already obtained, so a reused arena stops
+/// touching the heap once it has grown to the size of the biggest response.
+class Arena {
+public:
+    explicit Arena(size_t block_size = 64 * 1024);
+    ~Arena();
+
+    Arena(const Arena&)            = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t size, size_t align = alignof(uint64_t));
+    /// Copy of str, not NUL-terminated
+    const char* Copy(StringRef str);
+    /// Forget everything allocated, keeping the memory
+    void  Reset();
+    /// Give the memory back
+    void  Release();
+
+    size_t getUsed()     const;
+    size_t getCapacity() const;
+
+private:
+    struct Block {
+        char*  data;
+        size_t size;
+    };
+
+    bool NextBlock(size_t size, size_t align);
+
+    vector<Block> blocks;
+    size_t        block_size;   ///< Size of the next new block, doubles up to a cap
+    size_t        current;      ///< Block being filled
+    char*         ptr;
+    char*         end;
+    size_t        used;         ///< In blocks before the current one
+};
+
+/// Tree node, children of a container are one contiguous array in the arena
+struct ArenaNode {
+    enum Kind : uint8_t {
+        NODE_NULL,
+        NODE_BOOL,
+        NODE_INT,
+        NODE_UINT,
+        NODE_DOUBLE,
+        NODE_STRING,
+        NODE_ARRAY,
+        NODE_OBJECT
+    };
+
+    const char* key;            ///< Member name, unescaped and interned when possible
+    uint32_t    key_size;
+    Kind        kind;
+    uint32_t    size;           ///< String length or number of children
+    union {
+        bool              boolean;
+        int64_t           int64;
+        uint64_t          uint64;
+        double            real;
+        const char*       str;
+        const ArenaNode*  children;
+    };
+};
+
+/// Read-only handle of a node, cheap to copy. Accessors follow Json::Value naming,
+/// missing members and elements give a view with exists() false that returns defaults.
+class ArenaValue {
+public:
+    ArenaValue(const ArenaNode* node = nullptr) : node(node) {}
+
+    JsonView::Type type() const;
+    bool exists()   const { return node != nullptr; }
+    bool isNull()   const { return type() == JsonView::NULL_VALUE; }
+    bool isBool()   const { return type() == JsonView::BOOL; }
+    bool isNumber() const { return type() == JsonView::NUMBER; }
+    bool isString() const { return type() == JsonView::STRING; }
+    bool isArray()  const { return type() == JsonView::ARRAY; }
+    bool isObject() const { return type() == JsonView::OBJECT; }
+
+    ArenaValue operator[](StringRef key) const;   ///< Linear in members, by address for VK field names
+    ArenaValue operator[](size_t index)  const;   ///< Constant time
+    size_t     size() const;
+
+    bool      asBool  (bool def = false)       const;
+    int       asInt   (int def = 0)            const;
+    int64_t   asInt64 (int64_t def = 0)        const;
+    uint64_t  asUInt64(uint64_t def = 0)       const;
+    ID        asID    (ID def = 0)             const;   ///< Stored as integer, no conversion
+    double    asDouble(double def = 0)         const;
+    string    asString(const string& def = "") const;
+    StringRef getString() const;                  ///< String without copying, valid while the arena is
+    StringRef key()       const;                  ///< Member name, empty for others
+
+    VKValue   toValue() const;                    ///< Materialize the subtree as Json::Value
+
+    /// Walks elements of an array or members of an object
+    class Iterator {
+    public:
+        explicit Iterator(const ArenaNode* node) : node(node) {}
+        ArenaValue operator*() const { return ArenaValue(node); }
+        StringRef  key()       const { return ArenaValue(node).key(); }
+        Iterator&  operator++()      { ++node; return *this; }
+        bool operator==(const Iterator& other) const { return node == other.node; }
+        bool operator!=(const Iterator& other) const { return node != other.node; }
+    private:
+        const ArenaNode* node;
+    };
+
+    Iterator begin() const;
+    Iterator end()   const;
+
+private:
+    const ArenaNode* node;
+};
+
+/// DOM built in an arena, as a JsonHandler it takes events straight from the
+/// push parser, e.g. as the handler of VKAPI::Request(). Clearing is O(1) and a
+/// reused document parses without heap allocations once the arena is warm.
+/// Member names are interned, repeated names of item arrays share one copy.
+/// After a failed parse Clear() it before feeding it again.
+class ArenaDocument : public JsonHandler {
+public:
+    explicit ArenaDocument(size_t block_size = 64 * 1024);
+
+    /// Parse a whole text, replacing the tree
+    bool Parse(const char* data, size_t size);
+    bool Parse(const string& text);
+    /// Drop the tree, keeping the memory
+    void Clear();
+
+    ArenaValue    getRoot()  const;
+    const Arena&  getArena() const;
+    const KeyTable& getKeys() const;
+    const string& getError() const;
+
+    bool Null();
+    bool Bool  (bool value);
+    bool Int64 (int64_t value);
+    bool Uint64(uint64_t value);
+    bool Double(double value);
+    bool String(StringRef value);
+    bool Key   (StringRef key);
+    bool StartObject();
+    bool EndObject();
+    bool StartArray();
+    bool EndArray();
+
+private:
+    /// Container being built, its children are on scratch from `first`
+    struct Frame {
+        size_t      first;
+        const char* key;
+        uint32_t    key_size;
+    };
+
+    ArenaNode& Add(ArenaNode::Kind kind);
+    bool       Start();
+    bool       End(ArenaNode::Kind kind);
+
+    Arena             arena;
+    KeyTable          keys;       ///< Kept by Clear(), names repeat across responses
+    vector<ArenaNode> scratch;    ///< Children of open containers, reused between documents
+    vector<Frame>     frames;
+    const char*       key;        ///< Name for the next member
+    uint32_t          key_size;
+    ArenaNode         root;
+    bool              complete;   ///< Root is done, next event starts a new document
+    string            error;
+};
+
+}
+
+#endif // VKAPI_ARENA_HPP
@@ -0,0 +1,70 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_ASYNC_HPP
+#define VKAPI_ASYNC_HPP
+
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <thread>
+#include <future>
+#include <functional>
+#include <condition_variable>
+
+#include "vkapi.hpp"
+
+namespace vk {
+
+/// Async mode: requests are queued and performed by worker threads, each owning a VKAPI.
+///
+/// Workers share a ConcurrencyController, so the number of requests actually
+/// in flight follows what the host sustains instead of the number of workers,
+/// which is only the upper bound:
+///     AsyncPool pool(32, [&](VKAPI& api) {
+///         api.SetDefaultAccessToken(token);
+///         api.SetScheduler(scheduler);
+///     });
+///     std::future<VKValue> users = pool.Submit("users.get", args);
+class AsyncPool {
+public:
+    /// Configures a worker's VKAPI, called once per worker in the constructor
+    typedef std::function<void(VKAPI&)> Setup;
+
+    AsyncPool(size_t workers, const Setup& setup,
+              const std::shared_ptr<ConcurrencyController>& controller = std::make_shared<ConcurrencyController>());
+    /// Waits for requests already submitted
+    ~AsyncPool();
+
+    AsyncPool(const AsyncPool&)            = delete;
+    AsyncPool& operator=(const AsyncPool&) = delete;
+
+    /// Future gets the response or the exception Request() threw
+    std::future<VKValue> Submit(const string& method, const Args& arguments,
+                                const RequestContext& ctx = RequestContext());
+
+    size_t getPending() const;   ///< Submitted and not yet taken by a worker
+    const std::shared_ptr<ConcurrencyController>& getController() const;
+
+private:
+    struct Job {
+        string                  method;
+        Args                    arguments;
+        RequestContext          ctx;
+        std::promise<VKValue>   promise;
+    };
+
+    void Worker(VKAPI* api);
+
+    mutable std::mutex                      mtx;
+    std::condition_variable                 cv;
+    std::deque<std::unique_ptr<Job>>        jobs;
+    bool                                    stopping;
+    std::shared_ptr<ConcurrencyController>  controller;
+    vector<std::unique_ptr<VKAPI>>          apis;
+    vector<std::thread>                     threads;
+};
+
+}
+
+#endif // VKAPI_ASYNC_HPP
@@ -0,0 +1,99 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_CIRCUIT_BREAKER_HPP
+#define VKAPI_CIRCUIT_BREAKER_HPP
+
+#include <map>
+#include <mutex>
+#include <chrono>
+
+#include "types.hpp"
+
+namespace vk {
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+struct CircuitBreakerSettings {
+    size_t        window          = 50;     ///< Outcomes remembered by a breaker
+    size_t        min_calls       = 20;     ///< Don't judge before that many outcomes
+    double        error_ratio     = 0.5;    ///< Open when failures make up this share of the window
+    milliseconds  slow_call       = milliseconds(3000);  ///< Calls slower than that are "slow"
+    double        slow_ratio      = 0.8;    ///< Open when slow calls make up this share of the window
+    milliseconds  open_duration   = milliseconds(5000);  ///< Fail fast that long before probing
+    size_t        half_open_calls = 3;      ///< Trial calls in half-open state, all must succeed to close
+};
+
+/// Classic closed -> open -> half-open -> closed breaker over a sliding window of outcomes.
+/// Not thread-safe by itself, CircuitBreakerGroup serializes access.
+class CircuitBreaker {
+public:
+    enum State {
+        CLOSED,
+        OPEN,
+        HALF_OPEN
+    };
+
+    explicit CircuitBreaker(const CircuitBreakerSettings& settings = CircuitBreakerSettings());
+
+    /// May the call go? In half-open state takes one of the trial slots and sets trial
+    bool Allow(bool* trial = nullptr);
+
+    void OnSuccess(milliseconds latency);
+    void OnFailure();
+
+    /// Call was allowed but never finished (e.g. cancelled), give back its trial slot.
+    /// Calls let through while closed hold none, trial tells which kind it was.
+    void Release(bool trial);
+
+    State getState() const;
+
+private:
+    void Push(bool failure, bool slow);
+    void Trip();
+    void Reset();
+
+    CircuitBreakerSettings    settings;
+    State                     state;
+    vector<uint8_t>           outcomes;     ///< bit 0: failure, bit 1: slow
+    size_t                    next;
+    size_t                    failures;
+    size_t                    slow_calls;
+    size_t                    trials_left;
+    size_t                    trials_ok;
+    steady_clock::time_point  opened_at;
+};
+
+/// Trial slots a call allowed by CircuitBreakerGroup holds, to be given back by Release()
+struct CircuitBreakerPermit {
+    bool host_trial   = false;
+    bool method_trial = false;
+};
+
+/// Breakers per host and per method, a call must pass both.
+/// A failing method is isolated on its own, a failing host stops everything on it.
+/// Thread-safe, meant to be shared between VKAPI instances of one process.
+class CircuitBreakerGroup {
+public:
+    explicit CircuitBreakerGroup(const CircuitBreakerSettings& settings = CircuitBreakerSettings());
+
+    bool Allow  (const string& host, const string& method, CircuitBreakerPermit& permit);
+    void Success(const string& host, const string& method, milliseconds latency);
+    void Failure(const string& host, const string& method, milliseconds latency, bool transport);
+    void Release(const string& host, const string& method, const CircuitBreakerPermit& permit);
+
+    CircuitBreaker::State getHostState  (const string& host)   const;
+    CircuitBreaker::State getMethodState(const string& method) const;
+
+private:
+    CircuitBreaker& Breaker(map<string, CircuitBreaker>& breakers, const string& key);
+
+    mutable std::mutex           mtx;
+    CircuitBreakerSettings       settings;
+    map<string, CircuitBreaker>  hosts;
+    map<string, CircuitBreaker>  methods;
+};
+
+}
+
+#endif // VKAPI_CIRCUIT_BREAKER_HPP
@@ -0,0 +1,69 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_COLUMNS_HPP
+#define VKAPI_COLUMNS_HPP
+
+#include "types.hpp"
+#include "sax.hpp"
+#include "arena.hpp"
+#include "item_stream.hpp"
+
+namespace vk {
+
+/// Fields of response items copied into contiguous typed columns, a row per item,
+/// ready for vectorized aggregation without walking any tree afterwards.
+///
+/// Filled by VKAPI::RequestColumns() while the response streams in, so the items
+/// are never held as a DOM. Storage is kept by Clear() for the next page.
+class ColumnSet {
+public:
+    enum ColumnType {
+        COLUMN_ID,       ///< IDArray
+        COLUMN_INT,      ///< vector<int>
+        COLUMN_DOUBLE,   ///< vector<double>
+        COLUMN_STRING    ///< Characters of all rows in one buffer, indexed by offsets
+    };
+
+    ColumnSet();
+
+    /// Path is member names relative to the item separated by dots, e.g. "city.id".
+    /// Missing or mistyped values become 0 or empty. Returns the column index.
+    size_t AddColumn(const string& path, ColumnType type);
+
+    /// Append a row taken from item
+    void Append(const ArenaValue& item);
+    /// Drop rows, keeping columns and memory
+    void Clear();
+    /// Drop rows past the first `rows`, e.g. those of a request that failed midway
+    void Truncate(size_t rows);
+
+    size_t getRows()    const;
+    size_t getColumns() const;
+
+    const IDArray&        getIDs    (size_t column) const;
+    const vector<int>&    getInts   (size_t column) const;
+    const vector<double>& getDoubles(size_t column) const;
+    StringRef             getString (size_t column, size_t row) const;
+
+    /// Callback appending every item, for RequestItems() or an ItemStream
+    ItemStream::Callback Collector();
+
+private:
+    struct Column {
+        ColumnType        type;
+        vector<string>    path;
+        IDArray           ids;
+        vector<int>       ints;
+        vector<double>    doubles;
+        string            chars;
+        vector<uint32_t>  offsets;   ///< Row i is chars[offsets[i], offsets[i + 1])
+    };
+
+    vector<Column> columns;
+    size_t         rows;
+};
+
+}
+
+#endif // VKAPI_COLUMNS_HPP
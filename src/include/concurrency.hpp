@@ -0,0 +1,99 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_CONCURRENCY_HPP
+#define VKAPI_CONCURRENCY_HPP
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <memory>
+#include <condition_variable>
+#include <stdint.h>
+
+#include "types.hpp"
+#include "request_context.hpp"
+
+namespace vk {
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+struct ConcurrencySettings {
+    size_t  initial_limit  = 4;
+    size_t  min_limit      = 1;
+    size_t  max_limit      = 64;
+    double  alpha          = 3;     ///< Grow while fewer requests than that are queued somewhere
+    double  beta           = 6;     ///< Shrink when more than that are queued
+    double  backoff        = 0.9;   ///< Limit multiplier on a dropped call (timeout or throttling)
+    size_t  probe_interval = 1000;  ///< Samples between forgetting the no-load latency, 0 never
+};
+
+/// Vegas-style limit of requests in flight to one host.
+///
+/// The best latency seen is taken as no-load latency, the gradient
+/// no_load / latency of every call tells how many requests are queued
+/// on the way (limit * (1 - gradient)). While the queue is short the limit
+/// grows by one, when it gets long the limit shrinks by one, dropped calls
+/// cut it by `backoff`. So the limit settles where more concurrency stops
+/// buying throughput, including when the rate limiter is the bottleneck.
+/// Thread-safe.
+class ConcurrencyLimiter {
+public:
+    explicit ConcurrencyLimiter(const ConcurrencySettings& settings = ConcurrencySettings());
+
+    /// Blocks while the limit is reached.
+    /// Throws CancelledException / DeadlineException according to ctx.
+    void Acquire(const RequestContext& ctx);
+    /// Slot right now without waiting, false if the limit is reached
+    bool TryAcquire();
+
+    /// Call finished, `dropped` if it timed out or VK throttled it
+    void Release(milliseconds latency, bool dropped);
+    /// Call never finished (e.g. cancelled), no sample to learn from
+    void Release();
+
+    /* Metrics */
+
+    size_t       getLimit()         const;
+    size_t       getInFlight()      const;
+    milliseconds getNoLoadLatency() const;   ///< Best latency seen lately
+    uint64_t     getIncreases()     const;
+    uint64_t     getDecreases()     const;
+
+private:
+    void SetLimit(size_t new_limit, const char* reason);
+
+    mutable std::mutex        mtx;
+    std::condition_variable   cv;
+    ConcurrencySettings       settings;
+    size_t                    limit;
+    size_t                    in_flight;
+    milliseconds              no_load;
+    size_t                    samples;
+    uint64_t                  increases;
+    uint64_t                  decreases;
+};
+
+/// ConcurrencyLimiter per host, the way VKAPI uses it.
+/// Thread-safe, meant to be shared by every VKAPI of the process, e.g. by AsyncPool workers.
+class ConcurrencyController {
+public:
+    explicit ConcurrencyController(const ConcurrencySettings& settings = ConcurrencySettings());
+
+    void Acquire(const string& host, const RequestContext& ctx);
+    bool TryAcquire(const string& host);
+    void Release(const string& host, milliseconds latency, bool dropped);
+    void Release(const string& host);
+
+    /// Limiter of the host, created on first use
+    ConcurrencyLimiter& getLimiter(const string& host);
+
+private:
+    std::mutex                                        mtx;
+    ConcurrencySettings                               settings;
+    map<string, std::unique_ptr<ConcurrencyLimiter>>  limiters;
+};
+
+}
+
+#endif // VKAPI_CONCURRENCY_HPP
@@ -0,0 +1,52 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_INTERN_HPP
+#define VKAPI_INTERN_HPP
+
+#include <deque>
+#include <unordered_map>
+
+#include "types.hpp"
+#include "sax.hpp"
+
+namespace vk {
+
+/// FNV-1a over the characters
+struct StringRefHash {
+    size_t operator()(const StringRef& str) const {
+        uint64_t hash = 14695981039346656037ULL;
+        for(size_t i = 0; i < str.size; i++) {
+            hash ^= static_cast<unsigned char>(str.data[i]);
+            hash *= 1099511628211ULL;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+/// Canonical storage of member names: equal names interned by any table share
+/// one pointer, so repeated keys cost no memory and compare by address.
+///
+/// Field names of the VK schema live in a static table shared by all threads,
+/// names it lacks are kept by the table instance up to `limit` of them.
+class KeyTable {
+public:
+    explicit KeyTable(size_t limit = 4096);
+
+    /// Canonical copy of name, data is nullptr if it is unknown and the table is full
+    StringRef Intern(StringRef name);
+    /// Canonical copy from the static table, data is nullptr if the name isn't there
+    static StringRef Known(StringRef name);
+
+    void   Clear();
+    size_t getSize() const;   ///< Names held by this table, static ones not counted
+
+private:
+    std::unordered_map<StringRef, const char*, StringRefHash> names;
+    std::deque<string> storage;   ///< Never relocates its strings
+    size_t             limit;
+};
+
+}
+
+#endif // VKAPI_INTERN_HPP
@@ -0,0 +1,93 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_ITEM_STREAM_HPP
+#define VKAPI_ITEM_STREAM_HPP
+
+#include <functional>
+
+#include "types.hpp"
+#include "sax.hpp"
+#include "arena.hpp"
+
+namespace vk {
+
+/// Incremental decoder handing out elements of `items` arrays under `response`,
+/// `execute` results packing several pages included, one at a time.
+///
+/// Each element is built in a reused arena and given to the callback as soon as
+/// its last byte is fed, the rest of the body is looked at and dropped, so memory
+/// stays at one item however big the page is.
+class ItemStream : public JsonHandler {
+public:
+    /// The item is valid during the call only
+    typedef std::function<void(const ArenaValue& item)> Callback;
+
+    explicit ItemStream(const Callback& callback);
+
+    /// Next chunk of the body, false on syntax error
+    bool Feed(const char* data, size_t size);
+    /// End of the body, false if it is incomplete
+    bool Finish();
+    /// Start over with a new body
+    void Reset();
+
+    size_t        getItems()   const;   ///< Delivered so far
+    bool          isResponse() const;   ///< First member of the body is "response"
+    bool          isError()    const;   ///< First member of the body is "error"
+    bool          hasError()   const;
+    const string& getError()   const;
+
+    bool Null();
+    bool Bool  (bool value);
+    bool Int64 (int64_t value);
+    bool Uint64(uint64_t value);
+    bool Double(double value);
+    bool String(StringRef value);
+    bool Key   (StringRef key);
+    bool StartObject();
+    bool EndObject();
+    bool StartArray();
+    bool EndArray();
+
+private:
+    enum Envelope {
+        ENVELOPE_UNKNOWN,
+        ENVELOPE_RESPONSE,
+        ENVELOPE_ERROR,
+        ENVELOPE_OTHER
+    };
+
+    enum Name {
+        NAME_OTHER,
+        NAME_RESPONSE,
+        NAME_ITEMS
+    };
+
+    /// Container outside of items
+    struct Frame {
+        bool object;
+        bool response;   ///< Inside "response"
+        bool items;      ///< Is an items array
+    };
+
+    /// Next event belongs to an item: it is inside one or starts one
+    bool InItem() const { return depth > 0 || (!frames.empty() && frames.back().items); }
+    bool Scalar(bool forwarded);
+    bool Start(bool object);
+    bool End();
+    bool Deliver();
+
+    Callback       callback;
+    JsonPushParser parser;
+    ArenaDocument  item;
+    vector<Frame>  frames;
+    Name           name;        ///< Name of the member whose value comes next
+    size_t         depth;       ///< Nesting inside the item being built, 0 between items
+    size_t         items;
+    Envelope       envelope;
+};
+
+}
+
+#endif // VKAPI_ITEM_STREAM_HPP
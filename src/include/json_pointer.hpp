@@ -0,0 +1,47 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_JSON_POINTER_HPP
+#define VKAPI_JSON_POINTER_HPP
+
+#include "types.hpp"
+#include "json_view.hpp"
+
+namespace vk {
+
+/// JSON pointer (RFC 6901) with one extension: a "*" token matches every element
+/// of an array or member of an object, e.g. "/response/items/*/id".
+///
+/// Selection walks a JsonDocument: subtrees off the path are skipped through the
+/// structural index in one step each and nothing but the selected values is decoded.
+/// An invalid document has a missing root, from which nothing is selected.
+class JsonPointer {
+public:
+    /// Throws JsonException on malformed pointer
+    explicit JsonPointer(const string& pointer);
+
+    /// Values selected in root, in document order
+    void     Select(const JsonView& root, vector<JsonView>& found) const;
+    /// First selected value, missing if none
+    JsonView Get(const JsonView& root) const;
+
+    bool          isWildcard() const;   ///< May select more than one value
+    const string& getPointer() const;
+
+private:
+    struct Token {
+        string name;
+        size_t index;      ///< Array index if the name is one, npos otherwise
+        bool   wildcard;
+    };
+
+    void Select(const JsonView& value, size_t token, vector<JsonView>& found, bool first) const;
+
+    string        pointer;
+    vector<Token> tokens;
+    bool          wildcard;
+};
+
+}
+
+#endif // VKAPI_JSON_POINTER_HPP
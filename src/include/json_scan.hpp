@@ -0,0 +1,41 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_JSON_SCAN_HPP
+#define VKAPI_JSON_SCAN_HPP
+
+#include <stdint.h>
+
+#include "types.hpp"
+
+namespace vk {
+
+/// Vector instruction sets the scanners can use, picked at first use from what the CPU has
+enum SimdLevel {
+    SIMD_SCALAR,
+    SIMD_SSE2,
+    SIMD_AVX2
+};
+
+SimdLevel   simd_level();
+const char* simd_level_name(SimdLevel level);
+/// Use at most `level`, for benchmarks and comparisons. Returns the level in effect.
+SimdLevel   set_simd_level(SimdLevel level);
+
+/// Appends to `positions` offsets of the brackets, colons and commas outside strings and of
+/// every unescaped quote, in one pass of 64-byte blocks. False if the text ends inside a string,
+/// its opening quote is then the last position.
+bool scan_structure(const char* data, size_t size, vector<uint32_t>& positions);
+
+/// First character in [p, end) that ends a run of plain string content:
+/// quote, backslash or control character. `end` if there is none.
+const char* scan_plain(const char* p, const char* end);
+
+/// Decodes [data, data + size) if it is an optionally negative integer in JSON syntax whose
+/// magnitude fits uint64, the shape of IDs, dates and counters. Eight digits at a time.
+/// False for anything else, fractions and exponents included, leaving those to the general path.
+bool scan_integer(const char* data, size_t size, uint64_t* magnitude, bool* negative);
+
+}
+
+#endif // VKAPI_JSON_SCAN_HPP
@@ -0,0 +1,133 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_JSON_VIEW_HPP
+#define VKAPI_JSON_VIEW_HPP
+
+#include <stdint.h>
+
+#include "types.hpp"
+#include "sax.hpp"
+
+namespace vk {
+
+class JsonView;
+
+/// Structural index of a JSON text, built once in a single pass.
+///
+/// Records positions of brackets, colons, commas and string quotes, and
+/// for every opening bracket where it closes and where each of its children
+/// starts, so size() and indexing are constant time. Values are not parsed: a JsonView
+/// walks the index to what is asked for and converts just that, so reading
+/// `response.count` of a big response costs the index pass and nothing more.
+/// The text is not copied and must outlive the document and its views.
+class JsonDocument {
+public:
+    JsonDocument();
+    JsonDocument(const char* data, size_t size);
+    explicit JsonDocument(const string& text);
+
+    /// Index a new text, false if its structure is broken: brackets, member and element
+    /// layout are checked, so views never walk a broken index. A malformed scalar reads as the default value.
+    bool Reset(const char* data, size_t size);
+
+    JsonView      getRoot()   const;
+    bool          isValid()   const;
+    const string& getError()  const;
+    size_t        getTokens() const;   ///< Index size
+
+private:
+    friend class JsonView;
+
+    bool Index();
+
+    const char*       text;
+    size_t            size;
+    vector<uint32_t>  tokens;   ///< Positions of structural characters
+    vector<uint32_t>  match;    ///< For an opening bracket, token of its closing one
+    vector<uint32_t>  entry;    ///< For an opening bracket, offset of its children in `seps`
+    vector<uint32_t>  seps;     ///< Per container: child count, then the token before each child
+    string            error;
+};
+
+/// Read-only handle of a value inside a JsonDocument, cheap to copy.
+/// Accessors follow Json::Value naming. Missing members and elements
+/// give a view with exists() false, whose accessors return defaults.
+class JsonView {
+public:
+    enum Type {
+        MISSING,
+        NULL_VALUE,
+        BOOL,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    JsonView();
+
+    Type type()     const;
+    bool exists()   const { return doc != nullptr; }
+    bool isNull()   const { return type() == NULL_VALUE; }
+    bool isBool()   const { return type() == BOOL; }
+    bool isNumber() const { return type() == NUMBER; }
+    bool isString() const { return type() == STRING; }
+    bool isArray()  const { return type() == ARRAY; }
+    bool isObject() const { return type() == OBJECT; }
+
+    JsonView operator[](StringRef key) const;   ///< Linear in members
+    JsonView operator[](size_t index)  const;   ///< Constant time
+    size_t   size() const;                      ///< Elements or members, constant time
+
+    bool     asBool  (bool def = false)        const;
+    int      asInt   (int def = 0)             const;
+    int64_t  asInt64 (int64_t def = 0)         const;
+    uint64_t asUInt64(uint64_t def = 0)        const;
+    ID       asID    (ID def = 0)              const;   ///< Integer fast path, exact
+    double   asDouble(double def = 0)          const;
+    string   asString(const string& def = "")  const;   ///< Unescaped
+
+    StringRef getRaw()  const;          ///< Text of the value as in the document
+    VKValue   toValue() const;          ///< Materialize the subtree as Json::Value
+
+    /// Walks elements of an array or members of an object
+    class Iterator {
+    public:
+        JsonView  operator*() const;
+        StringRef key()       const;    ///< Member name as in the text, escapes not decoded
+        string    name()      const;    ///< Member name unescaped
+        Iterator& operator++();
+        bool operator==(const Iterator& other) const { return sep == other.sep; }
+        bool operator!=(const Iterator& other) const { return sep != other.sep; }
+
+    private:
+        friend class JsonView;
+        Iterator(const JsonDocument* doc, size_t sep, bool object) : doc(doc), sep(sep), object(object) {}
+
+        const JsonDocument* doc;
+        size_t              sep;        ///< Token before the element: opening bracket or comma, or closing bracket at end
+        bool                object;
+    };
+
+    Iterator begin() const;
+    Iterator end()   const;
+
+private:
+    friend class JsonDocument;
+    JsonView(const JsonDocument* doc, size_t tok, size_t pos) : doc(doc), tok(tok), pos(pos) {}
+
+    /// Value following separator token `sep`
+    static JsonView After(const JsonDocument* doc, size_t sep);
+    /// Token right after this value
+    size_t Next() const;
+    char   First() const { return doc->text[pos]; }
+
+    const JsonDocument* doc;
+    size_t              tok;   ///< Own token for containers and strings, following one for scalars
+    size_t              pos;   ///< First character
+};
+
+}
+
+#endif // VKAPI_JSON_VIEW_HPP
@@ -0,0 +1,88 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_QUOTA_HPP
+#define VKAPI_QUOTA_HPP
+
+#include <map>
+#include <mutex>
+#include <chrono>
+#include <stdint.h>
+
+#include "types.hpp"
+
+namespace vk {
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+/// Kind of access token, VK gives them different request budgets
+enum TokenType {
+    TOKEN_USER,
+    TOKEN_GROUP,
+    TOKEN_SERVICE,
+    TOKEN_TYPE_COUNT
+};
+
+/// Limits VK puts on a token beside the per second rate.
+///
+/// Per second budget depends on the token type, `execute` is one request in it
+/// no matter how many calls its code makes. Methods may also have caps over longer
+/// periods (e.g. posts or messages a day), and those are charged for every call,
+/// including calls made from `execute` code:
+///     auto quota = std::make_shared<QuotaPolicy>(TOKEN_GROUP);
+///     quota->SetMethodLimit("messages.send", 5000, hours(24));
+///     api.SetQuotaPolicy(quota);
+/// Thread-safe, meant to be shared by every VKAPI using the same token.
+class QuotaPolicy {
+public:
+    explicit QuotaPolicy(TokenType type = TOKEN_USER);
+
+    /// Charge one attempt to call method.
+    /// Throws QuotaExceededException, charging nothing, if any cap would be exceeded.
+    void Charge(const string& method, const Args& arguments);
+    /// Give back a charge of an attempt VK rejected without executing, e.g. with error 6
+    void Refund(const string& method, const Args& arguments);
+
+    void SetTokenType  (TokenType type);
+    void SetRate       (TokenType type, double rate);
+    /// At most `limit` calls in a window of `period` starting with the first call, 0 removes the cap
+    void SetMethodLimit(const string& method, uint32_t limit, milliseconds period);
+
+    TokenType getTokenType() const;
+    double    getRate()      const;   ///< Requests per second for the current token type
+
+    /// Methods called by execute code, in order of appearance.
+    /// Static guess: a call inside a loop is counted once.
+    static StrArray ExecuteCalls(const string& code);
+
+    /* Metrics */
+
+    uint64_t getRequests() const;                       ///< Requests charged, execute is one
+    uint64_t getCalls()    const;                       ///< API calls they carried
+    uint32_t getUsed     (const string& method) const;  ///< In the current window
+    uint32_t getRemaining(const string& method) const;  ///< UINT32_MAX if method has no cap
+
+private:
+    struct Limit {
+        uint32_t                  limit  = 0;
+        milliseconds              period = milliseconds(0);
+        uint32_t                  used   = 0;
+        steady_clock::time_point  window_start;
+    };
+
+    /// Start a new window if the current one is over
+    static void Roll(Limit& limit, steady_clock::time_point now);
+    /// Methods an attempt calls, those of execute code included
+    static StrArray Calls(const string& method, const Args& arguments);
+
+    mutable std::mutex  mtx;
+    TokenType           type;
+    double              rates[TOKEN_TYPE_COUNT];
+    map<string, Limit>  limits;
+    uint64_t            requests;
+    uint64_t            calls;
+};
+
+}
+
+#endif // VKAPI_QUOTA_HPP
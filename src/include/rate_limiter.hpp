@@ -0,0 +1,95 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_RATE_LIMITER_HPP
+#define VKAPI_RATE_LIMITER_HPP
+
+#include <mutex>
+#include <chrono>
+
+namespace vk {
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+/// Source of request permits.
+/// Never blocks: waiting, ordering and cancellation are up to the caller (see RequestScheduler).
+class RateLimiter {
+public:
+    virtual ~RateLimiter() {}
+
+    /// Take `cost` permits if they are available right now.
+    /// Otherwise returns false and sets `wait` to the time worth waiting before trying again.
+    virtual bool TryAcquire(double cost, milliseconds* wait) = 0;
+
+    /// Outcome of a request made with a permit, for limiters adapting to server feedback.
+    /// `throttled` means VK asked to slow down (errors 6 and 9).
+    virtual void Feedback(milliseconds /* latency */, bool /* throttled */) {}
+};
+
+/// In-process token bucket: `rate` permits per second, at most `burst` saved up.
+/// Thread-safe.
+class TokenBucket : public RateLimiter {
+public:
+    explicit TokenBucket(double rate = 3.0, double burst = 1.0);
+
+    bool TryAcquire(double cost, milliseconds* wait) override;
+
+    void   SetRate(double rate, double burst);
+    double getRate()  const;
+    double getBurst() const;
+
+private:
+    void Refill(steady_clock::time_point now);
+
+    mutable std::mutex        mtx;
+    double                    rate;
+    double                    burst;
+    double                    tokens;
+    steady_clock::time_point  last_refill;
+};
+
+/// Rate found by AIMD: while requests succeed the rate grows by `increase` permits
+/// per second each second, on throttling or a latency spike it is multiplied by `decrease`
+/// (at most once per `cooldown`, answers already in flight don't count twice).
+/// Converges just under the maximum rate VK sustains for the token. Thread-safe.
+class AdaptiveRateLimiter : public RateLimiter {
+public:
+    /// min_rate is kept positive and initial_rate within the bounds
+    AdaptiveRateLimiter(double initial_rate = 3.0, double min_rate = 1.0, double max_rate = 100.0);
+
+    bool TryAcquire(double cost, milliseconds* wait) override;
+    void Feedback(milliseconds latency, bool throttled) override;
+
+    void SetIncrease   (double increase);
+    void SetDecrease   (double decrease, milliseconds cooldown);
+    void SetSpikeFactor(double spike_factor);   ///< Latency above baseline * factor is a spike, 0 disables
+
+    /* Metrics */
+
+    double   getRate()      const;
+    double   getBaseline()  const;   ///< Smoothed latency, ms
+    uint64_t getThrottled() const;
+    uint64_t getDecreases() const;
+
+private:
+    void Decrease(const char* reason);
+
+    mutable std::mutex        mtx;
+    TokenBucket               bucket;
+    double                    rate;
+    double                    min_rate;
+    double                    max_rate;
+    double                    increase;
+    double                    decrease;
+    milliseconds              cooldown;
+    double                    spike_factor;
+    double                    baseline;
+    size_t                    samples;
+    uint64_t                  throttled;
+    uint64_t                  decreases;
+    steady_clock::time_point  last_decrease;
+};
+
+}
+
+#endif // VKAPI_RATE_LIMITER_HPP
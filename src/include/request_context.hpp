@@ -0,0 +1,86 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_REQUEST_CONTEXT_HPP
+#define VKAPI_REQUEST_CONTEXT_HPP
+
+#include <atomic>
+#include <memory>
+#include <chrono>
+#include <string>
+
+namespace vk {
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+/// Shared cancellation flag, copies refer to the same flag.
+/// Cancel() may be called from any thread.
+class CancellationToken {
+public:
+    CancellationToken() : flag(std::make_shared<std::atomic<bool>>(false)) {}
+
+    void Cancel()            { flag->store(true); }
+    bool isCancelled() const { return flag->load(); }
+
+private:
+    std::shared_ptr<std::atomic<bool>> flag;
+};
+
+/// Scheduling classes, see RequestScheduler
+enum RequestPriority {
+    PRIORITY_INTERACTIVE = 0,   ///< User is waiting for it, e.g. messages.send replies
+    PRIORITY_NORMAL      = 1,
+    PRIORITY_BULK        = 2,   ///< Background crawls and dumps
+
+    PRIORITY_COUNT
+};
+
+/// Deadline, cancellation and scheduling class of a single API call,
+/// including rate limiter waiting and retries
+class RequestContext {
+public:
+    RequestContext()
+        : deadline(steady_clock::time_point::max()) {}
+
+    explicit RequestContext(milliseconds timeout)
+        : deadline(steady_clock::now() + timeout) {}
+
+    RequestContext(milliseconds timeout, const CancellationToken& token)
+        : deadline(steady_clock::now() + timeout), token(token) {}
+
+    explicit RequestContext(const CancellationToken& token)
+        : deadline(steady_clock::time_point::max()), token(token) {}
+
+    void SetDeadline(steady_clock::time_point deadline) { this->deadline = deadline; }
+    void SetTimeout (milliseconds timeout)              { this->deadline = steady_clock::now() + timeout; }
+    void SetToken   (const CancellationToken& token)    { this->token = token; }
+    void SetPriority(RequestPriority priority)          { this->priority = priority; }
+    void SetTenant  (const std::string& tenant)         { this->tenant = tenant; }
+
+    bool hasDeadline() const { return deadline != steady_clock::time_point::max(); }
+    bool isExpired()   const { return hasDeadline() && steady_clock::now() >= deadline; }
+    bool isCancelled() const { return token.isCancelled(); }
+
+    /// Time left until deadline, milliseconds::max() if there is none
+    milliseconds getRemaining() const {
+        if(!hasDeadline()) return milliseconds::max();
+        steady_clock::time_point now = steady_clock::now();
+        if(now >= deadline) return milliseconds(0);
+        return std::chrono::duration_cast<milliseconds>(deadline - now);
+    }
+
+    steady_clock::time_point  getDeadline() const { return deadline; }
+    const CancellationToken&  getToken()    const { return token; }
+    RequestPriority           getPriority() const { return priority; }
+    const std::string&        getTenant()   const { return tenant; }
+
+private:
+    steady_clock::time_point  deadline;
+    CancellationToken         token;
+    RequestPriority           priority = PRIORITY_NORMAL;
+    std::string               tenant;
+};
+
+}
+
+#endif // VKAPI_REQUEST_CONTEXT_HPP
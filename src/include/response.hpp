@@ -0,0 +1,128 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_RESPONSE_HPP
+#define VKAPI_RESPONSE_HPP
+
+#include "types.hpp"
+#include "sax.hpp"
+#include "json_view.hpp"
+#include "arena.hpp"
+
+namespace vk {
+
+/// How a Response is parsed
+enum JsonBackend {
+    JSON_BACKEND_JSONCPP,   ///< Json::Value DOM, getJSON() compatible
+    JSON_BACKEND_ARENA,     ///< ArenaDocument, whole tree built without heap allocations
+    JSON_BACKEND_VIEW       ///< JsonDocument index, values parsed only when read
+};
+
+/// Backend of VKAPI instances unless changed by SetJsonBackend(), e.g.
+/// DEFINES += VKAPI_JSON_BACKEND=JSON_BACKEND_VIEW
+#ifndef VKAPI_JSON_BACKEND
+#define VKAPI_JSON_BACKEND JSON_BACKEND_JSONCPP
+#endif
+
+/// Read-only handle of a value of a Response, cheap to copy. Same accessors whatever
+/// the backend, so code written against it doesn't change when the backend does.
+/// Missing members and elements give a value with exists() false that returns defaults.
+class ResponseValue {
+public:
+    typedef JsonView::Type Type;
+
+    ResponseValue();
+    explicit ResponseValue(const VKValue* json);
+    ResponseValue(const JsonView& view);
+    ResponseValue(const ArenaValue& arena);
+
+    Type type()     const;
+    bool exists()   const { return type() != JsonView::MISSING; }
+    bool isNull()   const { return type() == JsonView::NULL_VALUE; }
+    bool isBool()   const { return type() == JsonView::BOOL; }
+    bool isNumber() const { return type() == JsonView::NUMBER; }
+    bool isString() const { return type() == JsonView::STRING; }
+    bool isArray()  const { return type() == JsonView::ARRAY; }
+    bool isObject() const { return type() == JsonView::OBJECT; }
+
+    ResponseValue operator[](StringRef key) const;
+    ResponseValue operator[](size_t index)  const;
+    size_t        size() const;
+
+    bool     asBool  (bool def = false)       const;
+    int      asInt   (int def = 0)            const;
+    int64_t  asInt64 (int64_t def = 0)        const;
+    uint64_t asUInt64(uint64_t def = 0)       const;
+    ID       asID    (ID def = 0)             const;
+    double   asDouble(double def = 0)         const;
+    string   asString(const string& def = "") const;
+
+    VKValue  toValue() const;                 ///< Materialize the subtree as Json::Value
+
+    /// Walks elements of an array or members of an object
+    class Iterator {
+    public:
+        ResponseValue operator*() const;
+        string        name()      const;      ///< Member name, empty for elements
+        Iterator&     operator++();
+        bool operator==(const Iterator& other) const;
+        bool operator!=(const Iterator& other) const { return !(*this == other); }
+
+    private:
+        friend class ResponseValue;
+        Iterator(JsonBackend backend) : backend(backend), view(JsonView().end()), arena(nullptr) {}
+
+        JsonBackend           backend;
+        VKValue::const_iterator json;
+        JsonView::Iterator    view;
+        ArenaValue::Iterator  arena;
+    };
+
+    Iterator begin() const;
+    Iterator end()   const;
+
+private:
+    JsonBackend     backend;
+    const VKValue*  json;
+    JsonView        view;
+    ArenaValue      arena;
+};
+
+/// Parsed response owned by one backend. VKAPI::RequestResponse() fills it with
+/// the backend chosen by VKAPI::SetJsonBackend(), it can also parse bodies itself.
+class Response {
+public:
+    explicit Response(JsonBackend backend = VKAPI_JSON_BACKEND);
+
+    Response(const Response&)            = delete;
+    Response& operator=(const Response&) = delete;
+
+    /// Parse text with the backend, replacing the previous response
+    bool Parse(const char* data, size_t size);
+    bool Parse(const string& text);
+
+    void          SetBackend(JsonBackend backend);   ///< Takes effect on the next response
+
+    ResponseValue getRoot()              const;
+    JsonBackend   getBackend()           const;   ///< Backend the current response was parsed with
+    JsonBackend   getConfiguredBackend() const;   ///< Backend of the next response, see SetBackend()
+    const string& getError()             const;
+
+private:
+    friend class VKAPI;
+
+    /// Drop the current response and switch to the configured backend
+    void Clear();
+
+    JsonBackend   backend;     ///< Configured
+    JsonBackend   parsed;      ///< Of the current response
+    VKValue       json;
+    JsonDocument  view;
+    string        text;        ///< Body indexed by view
+    ArenaDocument arena;
+    string        error;
+};
+
+}
+
+#endif // VKAPI_RESPONSE_HPP
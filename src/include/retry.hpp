@@ -0,0 +1,99 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_RETRY_HPP
+#define VKAPI_RETRY_HPP
+
+#include <set>
+#include <mutex>
+#include <memory>
+#include <random>
+#include <chrono>
+#include <curl/curl.h>
+
+#include "types.hpp"
+
+namespace vk {
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+/// Global limit on the amount of retries.
+/// Every request deposits `ratio` of a retry, every retry withdraws a whole one,
+/// so during incidents retries can't multiply the load on VK. `min_per_sec` retries
+/// are refilled with time to keep low traffic clients retrying at all.
+/// Thread-safe, may be shared between VKAPI instances.
+class RetryBudget {
+public:
+    explicit RetryBudget(double ratio = 0.1, double min_per_sec = 1.0, double max_balance = 10.0);
+
+    void   Deposit();
+    bool   Withdraw();
+    double getBalance() const;
+
+private:
+    void Refill();
+
+    mutable std::mutex        mtx;
+    double                    ratio;
+    double                    min_per_sec;
+    double                    max_balance;
+    double                    balance;
+    steady_clock::time_point  last_refill;
+};
+
+/// Decides which failed requests are worth repeating and when.
+/// Curl transport errors and VK errors are classified separately,
+/// delay grows exponentially with full jitter and is bounded by max_delay.
+///
+/// Retryable codes are retried for every method: by default only those telling the request
+/// wasn't executed. Idempotent codes are retried only for idempotent methods, by default
+/// errors after which VK may have executed the request, timeouts included, so a write isn't repeated.
+class RetryPolicy {
+public:
+    RetryPolicy();
+
+    /* Classification, also withdraws from the budget on positive answer */
+
+    bool ShouldRetry(CURLcode code, size_t attempt, bool idempotent = false);
+    bool ShouldRetry(int vk_code,   size_t attempt, bool idempotent = false);
+
+    /// Delay before retry number `attempt`, never less than `floor`
+    milliseconds Backoff(size_t attempt, milliseconds floor = milliseconds(0));
+
+    /// Every request performed pays to the retry budget
+    void OnRequest();
+
+    /* Setters */
+
+    void SetMaxRetries         (size_t max_retries);
+    void SetBackoff            (milliseconds base_delay, milliseconds max_delay);
+    void SetRetryableCurlCodes (const std::set<CURLcode>& codes);
+    void SetRetryableVKCodes   (const std::set<int>& codes);
+    void SetIdempotentCurlCodes(const std::set<CURLcode>& codes);
+    void SetIdempotentVKCodes  (const std::set<int>& codes);
+    void SetBudget             (const std::shared_ptr<RetryBudget>& budget);
+
+    /* Getters */
+
+    size_t                              getMaxRetries() const;
+    milliseconds                        getBaseDelay()  const;
+    milliseconds                        getMaxDelay()   const;
+    const std::shared_ptr<RetryBudget>& getBudget()     const;
+
+private:
+    bool Allow(size_t attempt);
+
+    size_t                        max_retries;
+    milliseconds                  base_delay;
+    milliseconds                  max_delay;
+    std::set<CURLcode>            curl_codes;
+    std::set<int>                 vk_codes;
+    std::set<CURLcode>            idempotent_curl_codes;
+    std::set<int>                 idempotent_vk_codes;
+    std::shared_ptr<RetryBudget>  budget;
+    std::mt19937                  rng;
+};
+
+}
+
+#endif // VKAPI_RETRY_HPP
@@ -0,0 +1,139 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_SAX_HPP
+#define VKAPI_SAX_HPP
+
+#include <string.h>
+#include <stdint.h>
+
+#include "types.hpp"
+
+namespace vk {
+
+/// Non-owning view of characters, C++11 stand-in for string_view.
+/// Handed to JsonHandler callbacks it is valid during the call only.
+struct StringRef {
+    const char* data;
+    size_t      size;
+
+    StringRef() : data(""), size(0) {}
+    StringRef(const char* data, size_t size) : data(data), size(size) {}
+    StringRef(const char* str) : data(str), size(strlen(str)) {}
+    StringRef(const string& str) : data(str.data()), size(str.size()) {}
+
+    string str()   const { return string(data, size); }
+    bool   empty() const { return size == 0; }
+
+    bool operator==(const StringRef& other) const {
+        return size == other.size && memcmp(data, other.data, size) == 0;
+    }
+    bool operator!=(const StringRef& other) const { return !(*this == other); }
+};
+
+/// Receiver of JSON parse events. Every callback returns false to stop parsing.
+/// Integers that fit int64 come as Int64, larger positive ones as Uint64,
+/// the rest of the numbers as Double. Strings come unescaped.
+class JsonHandler {
+public:
+    virtual ~JsonHandler() {}
+
+    virtual bool Null()                        { return true; }
+    virtual bool Bool  (bool /* value */)      { return true; }
+    virtual bool Int64 (int64_t /* value */)   { return true; }
+    virtual bool Uint64(uint64_t /* value */)  { return true; }
+    virtual bool Double(double /* value */)    { return true; }
+    virtual bool String(StringRef /* value */) { return true; }
+    virtual bool Key   (StringRef /* key */)   { return true; }
+    virtual bool StartObject()                 { return true; }
+    virtual bool EndObject()                   { return true; }
+    virtual bool StartArray()                  { return true; }
+    virtual bool EndArray()                    { return true; }
+};
+
+/// Incremental event parser: the document may be fed in chunks split anywhere.
+///
+/// Strings without escapes and numbers lying within one chunk are handed over
+/// as views into the input, others are assembled in a reused scratch buffer,
+/// so walking a response allocates nothing after warm-up and builds no DOM.
+class JsonPushParser {
+public:
+    explicit JsonPushParser(JsonHandler& handler, size_t max_depth = 512);
+
+    /// Parse next chunk. False on syntax error or when the handler stopped parsing.
+    bool Feed(const char* data, size_t size);
+    /// End of input, false if the document is incomplete
+    bool Finish();
+    /// Start over with a new document
+    void Reset();
+
+    bool          isDone()    const;   ///< A complete document was parsed
+    bool          isStopped() const;   ///< Handler returned false
+    bool          hasError()  const;
+    const string& getError()  const;
+    size_t        getOffset() const;   ///< Bytes consumed so far
+
+    /// Whole document at once. On syntax error `error` gets the message if given.
+    static bool Parse(const char* data, size_t size, JsonHandler& handler, string* error = nullptr);
+
+private:
+    enum State {
+        EXPECT_VALUE,
+        EXPECT_VALUE_OR_END,    ///< After '['
+        EXPECT_KEY,             ///< After ',' in object
+        EXPECT_KEY_OR_END,      ///< After '{'
+        EXPECT_COLON,
+        EXPECT_COMMA_OR_END,
+        EXPECT_DONE
+    };
+
+    enum Token {
+        TOKEN_NONE,
+        TOKEN_STRING,
+        TOKEN_NUMBER,
+        TOKEN_LITERAL
+    };
+
+    bool BeginValue(const char*& p);
+    bool ContinueString (const char*& p, const char* end);
+    bool ContinueEscape (const char*& p);
+    bool ContinueNumber (const char*& p, const char* end);
+    bool ContinueLiteral(const char*& p, const char* end);
+
+    bool EmitString(StringRef value);
+    bool EmitNumber(StringRef value);
+    bool EmitLiteral();
+    bool EndContainer(char close);
+    bool Emit(bool keep_going);
+    void ValueDone();
+
+    void AppendCodepoint(uint32_t cp);
+    void FlushSurrogate();
+
+    bool Fail(const char* p, const string& what);
+
+    JsonHandler&  handler;
+    size_t        max_depth;
+    vector<char>  stack;            ///< Open containers, '{' or '['
+    State         state;
+    Token         token;
+
+    string        scratch;          ///< Token split between chunks or unescaped
+    bool          buffered;         ///< String is being assembled in scratch
+    bool          is_key;
+    bool          in_escape;
+    char          escape[5];        ///< Hex digits of \u escape seen so far
+    size_t        escape_len;
+    uint32_t      high_surrogate;
+    const char*   literal;
+    size_t        literal_matched;
+
+    bool          stopped;
+    string        error;
+    size_t        consumed;         ///< Bytes of previous chunks
+    const char*   chunk;
+};
+
+}
+
+#endif // VKAPI_SAX_HPP
@@ -0,0 +1,116 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_SCHEDULER_HPP
+#define VKAPI_SCHEDULER_HPP
+
+#include <map>
+#include <deque>
+#include <mutex>
+#include <memory>
+#include <condition_variable>
+
+#include "types.hpp"
+#include "rate_limiter.hpp"
+#include "request_context.hpp"
+
+namespace vk {
+
+/// Orders callers waiting for rate limit permits.
+/// Permits are shared between priority classes by weight (stride scheduling),
+/// inside a class between tenants by tenant weight, inside a tenant FIFO.
+/// So a bulk crawl gets its share of the budget but never stands in front of
+/// interactive calls for more than its share.
+///
+/// Queue of each class may be bounded to shed load instead of letting waiters
+/// pile up, see SetQueueLimit().
+/// Thread-safe, one scheduler is meant to be shared by every VKAPI using the same token.
+class RequestScheduler {
+public:
+    /// What happens to a caller arriving at a full queue
+    enum AdmissionPolicy {
+        ADMIT_REJECT,       ///< Caller gets OverloadedException at once
+        ADMIT_DROP_OLDEST,  ///< Longest waiting caller of the class gets OverloadedException instead
+        ADMIT_BLOCK         ///< Caller waits for a free place up to a timeout, then gets OverloadedException
+    };
+
+    explicit RequestScheduler(double requests_per_sec = 3.0);
+    explicit RequestScheduler(const std::shared_ptr<RateLimiter>& limiter);
+
+    /// Blocks until the caller is granted a permit.
+    /// Throws CancelledException / DeadlineException according to ctx,
+    /// OverloadedException if shed by admission control.
+    void Acquire(const RequestContext& ctx);
+    /// Permit right now without waiting, false if one isn't available or others are queued for it
+    bool TryAcquire();
+
+    void SetLimiter     (const std::shared_ptr<RateLimiter>& limiter);
+    void SetWeight      (RequestPriority priority, double weight);
+    void SetTenantWeight(const string& tenant, double weight);
+    /// At most `limit` callers waiting in the class, 0 (default) is unbounded.
+    /// `block_timeout` is used by ADMIT_BLOCK only.
+    void SetQueueLimit  (RequestPriority priority, size_t limit, AdmissionPolicy policy,
+                         milliseconds block_timeout = milliseconds(1000));
+
+    /// Copy taken under the lock, SetLimiter() may replace it at any time
+    std::shared_ptr<RateLimiter> getLimiter() const;
+
+    /* Metrics */
+
+    size_t   getQueued    (RequestPriority priority) const;
+    size_t   getPeakQueued(RequestPriority priority) const;
+    uint64_t getGranted   (RequestPriority priority) const;
+    uint64_t getRejected  (RequestPriority priority) const;   ///< Refused at a full queue, timed out blocking included
+    uint64_t getDropped   (RequestPriority priority) const;   ///< Pushed out of a full queue by newer callers
+
+private:
+    struct Ticket {
+        uint64_t seq     = 0;
+        bool     granted = false;
+        bool     dropped = false;
+    };
+
+    struct Tenant {
+        std::deque<Ticket*> queue;
+        double              pass = 0;
+    };
+
+    struct Class {
+        map<string, Tenant> tenants;
+        double              weight  = 1;
+        double              pass    = 0;
+        double              vtime   = 0;
+        size_t              queued  = 0;
+        uint64_t            granted = 0;
+
+        size_t              limit         = 0;
+        AdmissionPolicy     policy        = ADMIT_REJECT;
+        milliseconds        block_timeout = milliseconds(1000);
+        size_t              peak          = 0;
+        uint64_t            rejected      = 0;
+        uint64_t            dropped       = 0;
+    };
+
+    /// Make room for one more caller in a bounded class or throw
+    void Admit  (std::unique_lock<std::mutex>& lock, Class& cls, const RequestContext& ctx);
+    void DropOldest(Class& cls);
+    void Enqueue(Class& cls, const string& tenant, Ticket* ticket);
+    void Remove (Class& cls, const string& tenant, Ticket* ticket);
+    void Grant  ();
+    void Dispatch();   ///< Grants what the limiter allows, mtx held
+
+    double TenantWeight(const string& tenant) const;
+
+    mutable std::mutex            mtx;
+    std::condition_variable       cv;
+    std::shared_ptr<RateLimiter>  limiter;
+    Class                         classes[PRIORITY_COUNT];
+    map<string, double>           tenant_weights;
+    double                        vtime;
+    uint64_t                      seq;
+    steady_clock::time_point      next_try;
+};
+
+}
+
+#endif // VKAPI_SCHEDULER_HPP
@@ -0,0 +1,61 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_SHARED_RATE_LIMITER_HPP
+#define VKAPI_SHARED_RATE_LIMITER_HPP
+
+#include <atomic>
+#include <stdint.h>
+
+#include "types.hpp"
+#include "rate_limiter.hpp"
+
+namespace vk {
+
+/// Token bucket shared by every process on the host using the same access token.
+///
+/// State lives in a small mmap'd file named after a hash of the token
+/// (the token itself is never written to disk) and is a single atomic
+/// "theoretical arrival time" of GCRA, updated with compare-and-swap.
+/// No lock is ever held, so a crashed process can't leave the bucket stuck;
+/// state left from a previous boot or a clock jump is clamped back on use.
+///
+/// All processes must use the same rate and burst. Use it as the limiter
+/// of a per-process RequestScheduler:
+///     auto limiter   = std::make_shared<SharedTokenBucket>(token, 3.0);
+///     auto scheduler = std::make_shared<RequestScheduler>(limiter);
+///     api.SetScheduler(scheduler);
+class SharedTokenBucket : public RateLimiter {
+public:
+    SharedTokenBucket(const string& access_token, double rate = 3.0, double burst = 1.0,
+                      const string& directory = "/dev/shm");
+    ~SharedTokenBucket();
+
+    SharedTokenBucket(const SharedTokenBucket&)            = delete;
+    SharedTokenBucket& operator=(const SharedTokenBucket&) = delete;
+
+    bool TryAcquire(double cost, milliseconds* wait) override;
+
+    const string& getPath()    const;
+    uint64_t      getGranted() const;   ///< By all processes since the file was created
+
+private:
+    /// Zero filled new file is a valid empty bucket
+    struct State {
+        std::atomic<uint64_t> magic;     ///< Layout version, set by the first user
+        std::atomic<int64_t>  tat_ns;    ///< Theoretical arrival time, CLOCK_MONOTONIC ns
+        std::atomic<uint64_t> granted;
+    };
+
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared rate limiter needs address-free 64 bit atomics");
+
+    string  path;
+    int     fd;
+    State*  state;
+    int64_t interval_ns;    ///< Time one permit is worth
+    int64_t tolerance_ns;   ///< How far ahead of now the arrival time may run, burst * interval
+};
+
+}
+
+#endif // VKAPI_SHARED_RATE_LIMITER_HPP
@@ -0,0 +1,62 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_SINGLE_FLIGHT_HPP
+#define VKAPI_SINGLE_FLIGHT_HPP
+
+#include <map>
+#include <mutex>
+#include <memory>
+#include <future>
+#include <atomic>
+#include <exception>
+
+#include "types.hpp"
+#include "request_context.hpp"
+
+namespace vk {
+
+/// Deduplication of identical requests in flight.
+/// First caller of a key becomes the leader and performs the request,
+/// callers arriving while it is in flight wait for the leader's result instead
+/// of spending rate limit on a duplicate. It is not a cache: once the leader
+/// finishes, the next caller starts a new request.
+/// Thread-safe, meant to be shared between VKAPI instances of one process.
+class SingleFlight {
+public:
+    class Call {
+    public:
+        Call() : future(promise.get_future().share()) {}
+
+    private:
+        friend class SingleFlight;
+        std::promise<VKValue>        promise;
+        std::shared_future<VKValue>  future;
+    };
+
+    SingleFlight() : deduplicated(0) {}
+
+    /// leader is set to true if the caller must perform the request and Complete() or Fail() it
+    std::shared_ptr<Call> Join(const string& key, bool* leader);
+
+    void Complete(const string& key, const std::shared_ptr<Call>& call, const VKValue& result);
+    void Fail    (const string& key, const std::shared_ptr<Call>& call, std::exception_ptr error);
+
+    /// Wait for the leader's result, rethrows leader's exception.
+    /// Honours ctx of the waiting caller with CancelledException / DeadlineException.
+    VKValue Wait(const std::shared_ptr<Call>& call, const RequestContext& ctx);
+
+    /// Amount of requests answered without being sent
+    uint64_t getDeduplicated() const;
+
+private:
+    void Finish(const string& key, const std::shared_ptr<Call>& call);
+
+    std::mutex                               mtx;
+    map<string, std::shared_ptr<Call>>       calls;
+    std::atomic<uint64_t>                    deduplicated;
+};
+
+}
+
+#endif // VKAPI_SINGLE_FLIGHT_HPP
@@ -17,6 +17,28 @@ inline string replaceAll(string str, const string& from, const string& to) {
     return str;
 }
 
+/// "https://api.vk.com/method/" -> "api.vk.com"
+inline string url_host(const string& url) {
+    size_t begin = url.find("://");
+    begin = (begin == string::npos) ? 0 : begin + 3;
+    size_t end = url.find_first_of("/?", begin);
+    return url.substr(begin, end == string::npos ? string::npos : end - begin);
+}
+
+/// "http://127.0.0.1:8080/method/" -> "127.0.0.1", "8080", port defaults to the scheme's
+inline void url_endpoint(const string& url, string* host, string* port) {
+    const string authority = url_host(url);
+    size_t colon = authority.rfind(':');
+    /// Brackets of IPv6 literal hide its colons
+    if(colon != string::npos && authority.find(']', colon) == string::npos) {
+        *host = authority.substr(0, colon);
+        *port = authority.substr(colon + 1);
+    } else {
+        *host = authority;
+        *port = (url.compare(0, 5, "http:") == 0) ? "80" : "443";
+    }
+}
+
 #define escape_spaces(str) replaceAll((str), " ", "%20")
 #define escape_percent(str) replaceAll((str), "%", "\%")
 
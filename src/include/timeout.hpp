@@ -0,0 +1,89 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_TIMEOUT_HPP
+#define VKAPI_TIMEOUT_HPP
+
+#include <set>
+#include <map>
+#include <mutex>
+#include <memory>
+#include <chrono>
+
+#include "types.hpp"
+
+namespace vk {
+using std::chrono::milliseconds;
+
+/// Keeps last `window` latencies of every method to estimate its percentiles.
+/// Thread-safe, may be shared between VKAPI instances.
+class LatencyTracker {
+public:
+    explicit LatencyTracker(size_t window = 256);
+
+    void   Record(const string& method, milliseconds latency);
+
+    /// p in [0, 1], returns 0ms if there are less than min_samples samples
+    milliseconds Percentile(const string& method, double p, size_t min_samples = 1) const;
+    size_t       getSamples(const string& method) const;
+
+private:
+    struct Samples {
+        vector<milliseconds::rep> ring;
+        size_t                    next = 0;
+    };
+
+    mutable std::mutex     mtx;
+    size_t                 window;
+    map<string, Samples>   methods;
+};
+
+/// Per method request timeouts derived from observed latency,
+/// and the hedging decision for idempotent methods.
+///     timeout = clamp(p99 * multiplier, min_timeout, max_timeout)
+///     hedge   = duplicate request after p95 if the first one hasn't finished yet
+class TimeoutPolicy {
+public:
+    TimeoutPolicy();
+
+    milliseconds Timeout(const string& method) const;
+
+    /// 0ms if hedging is off, method isn't idempotent or there are not enough samples
+    milliseconds HedgeDelay(const string& method) const;
+
+    bool IsIdempotent(const string& method) const;
+
+    void Record(const string& method, milliseconds latency);
+
+    /* Setters */
+
+    void SetAdaptive         (bool adaptive);
+    void SetBounds           (milliseconds min_timeout, milliseconds max_timeout);
+    void SetPercentile       (double percentile, double multiplier);
+    void SetMinSamples       (size_t min_samples);
+    void SetHedging          (bool hedging, double hedge_percentile = 0.95);
+    void SetIdempotentMethods(const std::set<string>& methods);
+    void SetTracker          (const std::shared_ptr<LatencyTracker>& tracker);
+
+    /* Getters */
+
+    bool                                   isAdaptive() const;
+    bool                                   isHedging()  const;
+    const std::shared_ptr<LatencyTracker>& getTracker() const;
+
+private:
+    bool                             adaptive;
+    milliseconds                     min_timeout;
+    milliseconds                     max_timeout;
+    double                           percentile;
+    double                           multiplier;
+    size_t                           min_samples;
+    bool                             hedging;
+    double                           hedge_percentile;
+    std::set<string>                 idempotent_methods;
+    std::shared_ptr<LatencyTracker>  tracker;
+};
+
+}
+
+#endif // VKAPI_TIMEOUT_HPP
@@ -11,8 +11,27 @@
 #include <exception>
 #include <curl/curl.h>
 #include <chrono>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
 
 #include "types.hpp"
+#include "retry.hpp"
+#include "timeout.hpp"
+#include "request_context.hpp"
+#include "circuit_breaker.hpp"
+#include "single_flight.hpp"
+#include "scheduler.hpp"
+#include "quota.hpp"
+#include "concurrency.hpp"
+#include "sax.hpp"
+#include "json_view.hpp"
+#include "arena.hpp"
+#include "item_stream.hpp"
+#include "columns.hpp"
+#include "json_pointer.hpp"
+#include "response.hpp"
 
 namespace vk {
 using std::chrono::milliseconds;
@@ -80,6 +99,29 @@ public:
 struct CurlException : public libVKException { using libVKException::libVKException; };
 struct JsonException : public libVKException { using libVKException::libVKException; };
 
+/// Call was cancelled through its CancellationToken or ran out of its deadline
+struct CancelledException : public libVKException { using libVKException::libVKException; };
+struct DeadlineException  : public libVKException { using libVKException::libVKException; };
+
+/// Call wasn't even tried, endpoint or method is considered unhealthy
+struct CircuitOpenException : public libVKException { using libVKException::libVKException; };
+
+/// Call was shed by admission control of RequestScheduler, the client is overloaded
+struct OverloadedException : public libVKException { using libVKException::libVKException; };
+
+/// Call wasn't sent, it would exceed a method quota of QuotaPolicy
+struct QuotaExceededException : public libVKException { using libVKException::libVKException; };
+
+/// Streamed response broke after some items were delivered, so it can't be retried transparently
+struct StreamException : public libVKException { using libVKException::libVKException; };
+
+/// Longest time a wait goes without checking for cancellation
+#define VKAPI_CANCEL_POLL_INTERVAL milliseconds(50)
+
+/// Longest a health probe of an idle connection may take before the connection is considered dead
+#define VKAPI_PROBE_TIMEOUT milliseconds(2000)
+
+/// Default endpoints, may be overridden at runtime with SetAPIUrl() / SetAuthUrl()
 #define VKAPI_URL       "https://api.vk.com/method/"
 #define VKAPI_AUTH_URL  "https://oauth.vk.com/"
 
@@ -95,12 +137,78 @@ struct JsonException : public libVKException { using libVKException::libVKExcept
 class VKAPI {
 public:
     VKAPI();
-    VKAPI(const string& app_id, const string& app_secret);
+    /// With `warmup` connections to the default endpoints are opened right away, see Warmup()
+    VKAPI(const string& app_id, const string& app_secret, bool warmup = false);
+    ~VKAPI();
+
+    /// Owns curl handles and is referenced by API subclasses, not copyable
+    VKAPI(const VKAPI&)            = delete;
+    VKAPI& operator=(const VKAPI&) = delete;
 
     /* Base functionality */
 
     API_RETURN_VALUE Authorize(const string& login, const string& passwd, string* access_token = NULL);
     API_RETURN_VALUE Request(const string& method, Args& arguments);
+    API_RETURN_VALUE Request(const string& method, Args& arguments, const RequestContext& ctx);
+
+    /// Walks the response with handler instead of building the DOM, getJSON() stays null.
+    /// VK errors are still thrown as VKException before the handler sees anything.
+    /// An ArenaDocument as the handler gives a DOM allocated from one reused arena.
+    void Request(const string& method, Args& arguments, JsonHandler& handler);
+    void Request(const string& method, Args& arguments, JsonHandler& handler, const RequestContext& ctx);
+
+    /// Indexes the response instead of building the DOM, values are parsed only when read
+    /// through the view, getJSON() stays null. The document is valid until the next request.
+    const JsonDocument& RequestView(const string& method, Args& arguments);
+    const JsonDocument& RequestView(const string& method, Args& arguments, const RequestContext& ctx);
+
+    /// Calls back with every element of response.items, `execute` packed pages included, as it
+    /// arrives from the network. The page is never held whole, getJSON() and getRawBody() stay empty.
+    /// Returns the number of items. Not hedged; retried only while no item was delivered,
+    /// later failures throw StreamException.
+    size_t RequestItems(const string& method, Args& arguments, const ItemStream::Callback& callback);
+    size_t RequestItems(const string& method, Args& arguments, const ItemStream::Callback& callback, const RequestContext& ctx);
+    /// RequestItems() appending a row to columns per item, rows of earlier pages are kept.
+    /// On failure the rows of this page are dropped, so every column keeps getRows() values.
+    size_t RequestColumns(const string& method, Args& arguments, ColumnSet& columns);
+    size_t RequestColumns(const string& method, Args& arguments, ColumnSet& columns, const RequestContext& ctx);
+    /// Only the values at JSON pointers ("/response/count", "/response/items/*/id"), keyed by pointer:
+    /// the value, null if missing, or an array of matches for "*" pointers. Walks the RequestView()
+    /// index, so the rest of the response is skipped undecoded. Throws JsonException on a bad pointer
+    /// or a body whose layout the index rejects, so selection never walks a broken index.
+    VKValue RequestPointers(const string& method, Args& arguments, const vector<string>& pointers);
+    VKValue RequestPointers(const string& method, Args& arguments, const vector<string>& pointers, const RequestContext& ctx);
+    /// Parses the response with the backend set by SetJsonBackend() and reads it through ResponseValue,
+    /// which doesn't change with the backend. Owns the parsed body, valid until the next RequestResponse()
+    /// whatever other requests are made meanwhile. getJSON() is only filled by the jsoncpp backend,
+    /// getView() is left empty, and so is getRawBody() with the view backend, the body moves to the response.
+    const Response& RequestResponse(const string& method, Args& arguments);
+    const Response& RequestResponse(const string& method, Args& arguments, const RequestContext& ctx);
+
+    /// Resolves API and auth hosts, pins the addresses for every transfer (refreshed
+    /// every DNS refresh period) and opens `connections` connections to the API host
+    /// and one to the auth host, TLS handshake included, so the first requests don't pay for it.
+    /// Best effort: failures are logged, returns the number of connections opened.
+    size_t Warmup(size_t connections = 2);
+
+    /// Write TLS sessions of this client to the file given to SetTLSSessionFile(), also done on destruction.
+    /// Needs libcurl 8.12+, returns false if nothing was written.
+    bool SaveTLSSessions();
+
+    /// Every `interval` of idleness a background thread probes pooled connections with
+    /// utils.getServerTime and replaces them if any is dead, so requests never land on a dead
+    /// socket after a quiet period. 0 stops it.
+    void SetHealthCheck(milliseconds interval);
+
+    /// Applies context to every call made through api while in scope, including API subclass methods
+    class ScopedContext {
+    public:
+        ScopedContext(VKAPI& api, const RequestContext& ctx) : api(api), saved(api.context) { api.context = ctx; }
+        ~ScopedContext() { api.context = saved; }
+    private:
+        VKAPI&          api;
+        RequestContext  saved;
+    };
 
     /* Setters */
 
@@ -110,13 +218,43 @@ public:
     void SetDefaultAccessToken(const string& token);
     void SetDefaultAPIVersion (const string& version);
     void SetMaxRequestsPerSec (const uint8_t max_requests);
+    void SetRetryPolicy       (const RetryPolicy& policy);
+    void SetTimeoutPolicy     (const TimeoutPolicy& policy);
+    void SetRequestContext    (const RequestContext& ctx);
+    void SetCircuitBreakers   (const std::shared_ptr<CircuitBreakerGroup>& breakers);
+    void SetSingleFlight      (const std::shared_ptr<SingleFlight>& single_flight);
+    void SetScheduler         (const std::shared_ptr<RequestScheduler>& scheduler);
+    void SetAdaptiveRate      (double min_rate, double max_rate);
+    void SetQuotaPolicy       (const std::shared_ptr<QuotaPolicy>& quota);
+    void SetConcurrencyController(const std::shared_ptr<ConcurrencyController>& concurrency);
+    void SetAPIUrl            (const string& url);
+    void SetAuthUrl           (const string& url);
+    void SetSSLVerifyPeer     (bool verify);
+    void SetDNSRefresh        (milliseconds period);   ///< Re-resolve pinned hosts that often, 0 never
+    void SetTLSSessionFile    (const string& path);    ///< Resume TLS sessions saved there by an earlier process
+    void SetJsonBackend       (JsonBackend backend);   ///< Parser of RequestResponse(), VKAPI_JSON_BACKEND by default
 
     /* Getters */
 
     CURLcode       getCurlError()   const;
     VKResultCode_t getVKError()     const;
     const VKValue& getJSON()        const;
+    const string&  getRawBody()     const;   ///< Last response as received, until the next request
+    const JsonDocument& getView()   const;   ///< Index of the last RequestView() response
+    JsonBackend    getJsonBackend() const;
+    const RetryPolicy&   getRetryPolicy()   const;
+    const TimeoutPolicy& getTimeoutPolicy() const;
+    const RequestContext& getRequestContext() const;
+    const std::shared_ptr<CircuitBreakerGroup>& getCircuitBreakers() const;
+    const std::shared_ptr<SingleFlight>&        getSingleFlight()    const;
+    const std::shared_ptr<RequestScheduler>&    getScheduler()       const;
+    const std::shared_ptr<QuotaPolicy>&         getQuotaPolicy()     const;
+    const std::shared_ptr<ConcurrencyController>& getConcurrencyController() const;
     const string&  getAccessToken() const;
+    const string&  getAPIUrl()      const;
+    const string&  getAuthUrl()     const;
+    uint64_t       getHealthProbes() const;
+    uint64_t       getReconnects()   const;
 
     /* API methods */
     inline API_RETURN_VALUE queue      (API_METHOD_ARGS);
@@ -605,20 +743,94 @@ public:
 private:
     /* CURL Write Function to read data from API */
     static size_t CurlWriteDataCallback(void* contents, size_t size, size_t nmemb, void* useptr);
+    static size_t CurlDiscardCallback  (void* contents, size_t size, size_t nmemb, void* useptr);
+    static size_t CurlStreamCallback   (void* contents, size_t size, size_t nmemb, void* useptr);
 
     void ReadDataToJSON();
+    void ReadDataToHandler();
+    void ReadDataToView();
+    void ReadStream();
+
+    /* Default access token, version and lang unless given */
+    void AppendDefaults(Args& arguments);
+
+    /* Request with retries, rate limiting and circuit breaking, arguments are complete already */
+    API_RETURN_VALUE Execute(const string& method, const Args& arguments, const RequestContext& ctx);
+
+    void CustomRequest(const string& url, const string& method, const Args& arguments, const RequestContext& ctx);
 
-    void CustomRequest(const string& url, const string& method, const Args& arguments);
+    /* Transfer with per method timeout, hedged by a duplicate request for slow idempotent calls */
+    CURLcode Perform(const string& method, const Args& arguments, const string& request_url, const RequestContext& ctx);
+
+    void SetupTransfer(CURL* handle, const string& request_url, string* buffer, milliseconds timeout);
+
+    /* Resolve API and auth hosts and pin them with CURLOPT_RESOLVE, false if nothing resolved.
+     * Resolves without curl_mtx and takes it to swap the list, so must be called without it. */
+    bool PinHosts();
+    void RefreshPinnedHosts();
+
+    size_t LoadTLSSessions();
+
+    /* GETs opening or reusing `connections` pooled connections to the API host, returns how many succeeded */
+    size_t OpenConnections(size_t connections, bool auth_host, milliseconds timeout);
+
+    void HealthLoop();
+    void CheckConnections();
+    void StopHealthCheck();
 
     void HandleError(const VKValue& json);
 
+    void WaitRateLimit(const RequestContext& ctx);
+    /* Rate limit permit right now without waiting, false if there is none */
+    bool TryRateLimit();
+    /* Everything a duplicate transfer of method needs: rate limit permit, quota and
+     * concurrency slot, taken only all together. False, taking nothing, if any is unavailable. */
+    bool AcquireHedge(const string& method, const Args& arguments, const string& host);
+    /* Per instance requests per second, the quota policy's current rate if set, never 0 */
+    double RequestRate() const;
+
+    void RetryBackoff(const string& method, size_t attempt, milliseconds floor, const RequestContext& ctx);
+
+    /* Outcome of an attempt for circuit breakers, adaptive rate limiter and concurrency controller */
+    void ReportOutcome(const string& host, const string& method, std::chrono::steady_clock::time_point slot_start,
+                       std::chrono::steady_clock::time_point start, VKResultCode_t result, bool transport = false);
+
+    /* Throw CancelledException or DeadlineException if ctx says so */
+    static void CheckContext(const RequestContext& ctx);
+    static void Sleep(milliseconds duration, const RequestContext& ctx);
+
     const string GenerateURL(const string& url, const string& method, const Args& arguments);
 
     string   app_id;
     string   app_secret;
 
+    string   api_url;
+    string   auth_url;
+
     VKValue        json;
     CURL*          curl_handle;
+    CURL*          hedge_handle;
+    CURLM*         curl_multi;
+    bool           ssl_verify_peer;
+    curl_slist*    resolve_list;
+    CURLSH*        tls_share;
+    string         tls_session_file;
+
+    /// Held while the multi handle is in use, by a request or by the health checker.
+    /// Setters of what the checker reads (endpoints, TLS options, pinned hosts) take it too.
+    std::mutex               curl_mtx;
+    size_t                   pool_connections;
+    std::chrono::steady_clock::time_point last_transfer;
+
+    std::thread              health_thread;
+    std::mutex               health_mtx;
+    std::condition_variable  health_cv;
+    bool                     health_stop;
+    milliseconds             health_interval;
+    std::atomic<uint64_t>    health_probes;
+    std::atomic<uint64_t>    reconnects;
+    milliseconds   dns_refresh;
+    std::chrono::steady_clock::time_point resolved_at;
     CURLcode       curl_errno;
     VKResultCode_t vk_errno;
 
@@ -627,6 +839,28 @@ private:
     string   def_lang;
 
     string   buffer;
+    string   hedge_buffer;
+
+    /// Receives the response instead of the DOM during Request() with a handler
+    JsonHandler*   sax_handler;
+    /// Set during RequestView(), the index over buffer goes to view
+    bool           lazy_view;
+    JsonDocument   view;
+    /// Set during RequestItems(), fed by the write callback
+    ItemStream*    item_stream;
+    std::exception_ptr stream_error;   ///< Thrown by the item callback inside curl
+    /// Filled by RequestResponse()
+    Response       response;
+
+    RetryPolicy    retry_policy;
+    TimeoutPolicy  timeout_policy;
+    RequestContext context;
+
+    std::shared_ptr<CircuitBreakerGroup> circuit_breakers;
+    std::shared_ptr<SingleFlight>        single_flight;
+    std::shared_ptr<RequestScheduler>    scheduler;
+    std::shared_ptr<QuotaPolicy>         quota;
+    std::shared_ptr<ConcurrencyController> concurrency;
 
     uint8_t      max_requests_per_second;
     uint8_t      request_counter;
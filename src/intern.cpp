@@ -0,0 +1,92 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "intern.hpp"
+
+namespace vk {
+
+/// Field names seen across users, groups, wall, messages and common envelopes
+static const char* const vk_fields[] = {
+    "response", "error", "error_code", "error_msg", "request_params", "execute_errors",
+    "method", "key", "value", "count", "items", "profiles", "groups", "next_from", "offset",
+
+    "id", "first_name", "last_name", "maiden_name", "nickname", "screen_name", "domain",
+    "deactivated", "is_closed", "can_access_closed", "sex", "bdate", "city", "country",
+    "title", "home_town", "photo", "photo_50", "photo_100", "photo_200", "photo_200_orig",
+    "photo_400_orig", "photo_max", "photo_max_orig", "photo_id", "crop_photo", "online",
+    "online_mobile", "online_app", "last_seen", "time", "platform", "has_photo", "has_mobile",
+    "mobile_phone", "home_phone", "site", "status", "verified", "trending", "followers_count",
+    "common_count", "counters", "occupation", "education", "university", "university_name",
+    "faculty", "faculty_name", "graduation", "universities", "schools", "relation", "relatives",
+    "personal", "connections", "activities", "interests", "music", "movies", "tv", "books",
+    "games", "about", "quotes", "timezone", "friend_status", "is_friend", "is_favorite",
+    "is_hidden_from_feed", "blacklisted", "blacklisted_by_me", "can_post", "can_see_all_posts",
+    "can_see_audio", "can_write_private_message", "can_send_friend_request", "lists",
+
+    "name", "type", "is_admin", "admin_level", "is_member", "is_advertiser", "members_count",
+    "description", "activity", "wiki_page", "start_date", "finish_date", "ban_info", "links",
+    "contacts", "fixed_post", "main_album_id", "market", "age_limits", "can_message",
+
+    "date", "owner_id", "from_id", "to_id", "post_id", "post_type", "text", "reply_owner_id",
+    "reply_post_id", "friends_only", "comments", "likes", "reposts", "views", "attachments",
+    "geo", "signer_id", "copy_history", "can_pin", "can_delete", "can_edit", "is_pinned",
+    "marked_as_ads", "post_source", "user_likes", "can_like", "can_comment",
+    "can_publish", "can_close", "groups_can_post", "edited", "hash",
+
+    "user_id", "group_id", "peer_id", "chat_id", "message", "messages", "conversation",
+    "conversations", "last_message", "out", "read_state", "random_id", "important",
+    "conversation_message_id", "fwd_messages", "reply_message", "in_read", "out_read",
+    "unread_count", "peer", "local_id", "can_write", "allowed", "reason",
+
+    "album_id", "access_key", "url", "src", "width", "height", "sizes", "duration", "artist",
+    "size", "ext", "doc", "audio", "video", "link", "poll", "sticker", "lat", "long",
+};
+
+typedef std::unordered_map<StringRef, const char*, StringRefHash> NameMap;
+
+static const NameMap& known_fields() {
+    /// Built once, read-only afterwards
+    static const NameMap fields = [] {
+        NameMap map;
+        for(const char* name : vk_fields) map.emplace(StringRef(name), name);
+        return map;
+    }();
+    return fields;
+}
+
+KeyTable::KeyTable(size_t limit) : limit(limit) {}
+
+StringRef
+KeyTable::Known(StringRef name) {
+    const NameMap& fields = known_fields();
+    auto it = fields.find(name);
+    return (it != fields.end()) ? StringRef(it->second, name.size) : StringRef(nullptr, 0);
+}
+
+StringRef
+KeyTable::Intern(StringRef name) {
+    StringRef known = Known(name);
+    if(known.data) return known;
+
+    auto it = names.find(name);
+    if(it != names.end()) return StringRef(it->second, name.size);
+    if(names.size() >= limit) return StringRef(nullptr, 0);
+
+    storage.push_back(name.str());
+    const string& copy = storage.back();
+    names.emplace(StringRef(copy), copy.data());
+    return StringRef(copy.data(), copy.size());
+}
+
+void
+KeyTable::Clear() {
+    names.clear();
+    storage.clear();
+}
+
+size_t
+KeyTable::getSize() const {
+    return names.size();
+}
+
+}
@@ -0,0 +1,144 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "item_stream.hpp"
+
+namespace vk {
+
+ItemStream::ItemStream(const Callback& callback)
+    : callback(callback), parser(*this) {
+    Reset();
+}
+
+bool
+ItemStream::Feed(const char* data, size_t size) {
+    return parser.Feed(data, size);
+}
+
+bool
+ItemStream::Finish() {
+    return parser.Finish();
+}
+
+void
+ItemStream::Reset() {
+    parser.Reset();
+    item.Clear();
+    frames.clear();
+    name     = NAME_OTHER;
+    depth    = 0;
+    items    = 0;
+    envelope = ENVELOPE_UNKNOWN;
+}
+
+size_t
+ItemStream::getItems() const {
+    return items;
+}
+
+bool
+ItemStream::isResponse() const {
+    return envelope == ENVELOPE_RESPONSE;
+}
+
+bool
+ItemStream::isError() const {
+    return envelope == ENVELOPE_ERROR;
+}
+
+bool
+ItemStream::hasError() const {
+    return parser.hasError();
+}
+
+const string&
+ItemStream::getError() const {
+    return parser.getError();
+}
+
+bool
+ItemStream::Deliver() {
+    items++;
+    callback(item.getRoot());
+    return true;
+}
+
+/// Called after a scalar was forwarded to the item or skipped
+bool
+ItemStream::Scalar(bool forwarded) {
+    name = NAME_OTHER;
+    /// Scalar element of an items array, e.g. IDs of friends.get
+    if(forwarded && depth == 0) return Deliver();
+    return true;
+}
+
+bool
+ItemStream::Start(bool object) {
+    if(InItem()) {
+        depth++;
+        return object ? item.StartObject() : item.StartArray();
+    }
+
+    Frame frame;
+    frame.object   = object;
+    frame.response = false;
+    frame.items    = false;
+    if(!frames.empty()) {
+        const Frame& parent = frames.back();
+        frame.response = parent.response || (frames.size() == 1 && name == NAME_RESPONSE);
+        frame.items    = !object && parent.response && parent.object && name == NAME_ITEMS;
+    }
+    frames.push_back(frame);
+    name = NAME_OTHER;
+    return true;
+}
+
+bool
+ItemStream::End() {
+    if(depth > 0) {
+        depth--;
+        return depth == 0 ? Deliver() : true;
+    }
+    frames.pop_back();
+    name = NAME_OTHER;
+    return true;
+}
+
+bool ItemStream::Null()                 { const bool f = InItem(); if(f) item.Null();         return Scalar(f); }
+bool ItemStream::Bool(bool value)       { const bool f = InItem(); if(f) item.Bool(value);    return Scalar(f); }
+bool ItemStream::Int64(int64_t value)   { const bool f = InItem(); if(f) item.Int64(value);   return Scalar(f); }
+bool ItemStream::Uint64(uint64_t value) { const bool f = InItem(); if(f) item.Uint64(value);  return Scalar(f); }
+bool ItemStream::Double(double value)   { const bool f = InItem(); if(f) item.Double(value);  return Scalar(f); }
+bool ItemStream::String(StringRef value){ const bool f = InItem(); if(f) item.String(value);  return Scalar(f); }
+
+bool
+ItemStream::Key(StringRef key) {
+    if(depth > 0) return item.Key(key);
+
+    if(frames.size() == 1 && envelope == ENVELOPE_UNKNOWN) {
+        envelope = (key == "response") ? ENVELOPE_RESPONSE
+                 : (key == "error")    ? ENVELOPE_ERROR
+                 :                       ENVELOPE_OTHER;
+    }
+    name = (key == "response") ? NAME_RESPONSE
+         : (key == "items")    ? NAME_ITEMS
+         :                       NAME_OTHER;
+    return true;
+}
+
+bool ItemStream::StartObject() { return Start(true); }
+bool ItemStream::StartArray()  { return Start(false); }
+
+bool
+ItemStream::EndObject() {
+    if(depth > 0) item.EndObject();
+    return End();
+}
+
+bool
+ItemStream::EndArray() {
+    if(depth > 0) item.EndArray();
+    return End();
+}
+
+}
@@ -0,0 +1,89 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "json_pointer.hpp"
+#include "vkapi.hpp"
+
+namespace vk {
+
+JsonPointer::JsonPointer(const string& pointer) : pointer(pointer), wildcard(false) {
+    /// Empty pointer is the whole document
+    if(pointer.empty()) return;
+    if(pointer[0] != '/') throw JsonException("JSON pointer must start with '/': " + pointer);
+
+    size_t begin = 1;
+    for(;;) {
+        size_t slash = pointer.find('/', begin);
+        const string raw = pointer.substr(begin, slash == string::npos ? string::npos : slash - begin);
+
+        Token token;
+        token.wildcard = (raw == "*");
+        token.index    = string::npos;
+        for(size_t i = 0; i < raw.size(); i++) {
+            if(raw[i] != '~') {
+                token.name += raw[i];
+            } else if(i + 1 < raw.size() && (raw[i + 1] == '0' || raw[i + 1] == '1')) {
+                token.name += (raw[++i] == '0') ? '~' : '/';
+            } else {
+                throw JsonException("invalid escape in JSON pointer: " + pointer);
+            }
+        }
+
+        /// Array index: digits without leading zeros
+        const string& name = token.name;
+        if(!name.empty() && name.size() < 19 && name.find_first_not_of("0123456789") == string::npos
+           && (name[0] != '0' || name.size() == 1)) {
+            token.index = std::stoull(name);
+        }
+
+        wildcard = wildcard || token.wildcard;
+        tokens.push_back(token);
+        if(slash == string::npos) break;
+        begin = slash + 1;
+    }
+}
+
+void
+JsonPointer::Select(const JsonView& root, vector<JsonView>& found) const {
+    Select(root, 0, found, false);
+}
+
+JsonView
+JsonPointer::Get(const JsonView& root) const {
+    vector<JsonView> found;
+    Select(root, 0, found, true);
+    return found.empty() ? JsonView() : found[0];
+}
+
+void
+JsonPointer::Select(const JsonView& value, size_t token, vector<JsonView>& found, bool first) const {
+    if(!value.exists()) return;
+    if(token == tokens.size()) {
+        found.push_back(value);
+        return;
+    }
+
+    const Token& t = tokens[token];
+    if(t.wildcard) {
+        for(JsonView::Iterator it = value.begin(), end = value.end(); it != end; ++it) {
+            Select(*it, token + 1, found, first);
+            if(first && !found.empty()) return;
+        }
+    } else if(value.isArray()) {
+        if(t.index != string::npos) Select(value[t.index], token + 1, found, first);
+    } else {
+        Select(value[StringRef(t.name)], token + 1, found, first);
+    }
+}
+
+bool
+JsonPointer::isWildcard() const {
+    return wildcard;
+}
+
+const string&
+JsonPointer::getPointer() const {
+    return pointer;
+}
+
+}
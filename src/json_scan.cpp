@@ -0,0 +1,306 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "json_scan.hpp"
+#include <string.h>
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define VKAPI_SIMD_X86
+#include <immintrin.h>
+#endif
+
+namespace vk {
+
+/// One bit per byte of a 64-byte block
+struct BlockMasks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t structural;
+};
+
+typedef void (*Classifier)(const char* block, BlockMasks& masks);
+
+static void classify_scalar(const char* block, BlockMasks& masks) {
+    masks.quote = masks.backslash = masks.structural = 0;
+    for(int i = 0; i < 64; i++) {
+        const uint64_t bit = 1ULL << i;
+        switch(block[i]) {
+        case '"':  masks.quote     |= bit; break;
+        case '\\': masks.backslash |= bit; break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+                   masks.structural |= bit; break;
+        }
+    }
+}
+
+static const char* plain_scalar(const char* p, const char* end) {
+    while(p < end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20) p++;
+    return p;
+}
+
+#ifdef VKAPI_SIMD_X86
+
+__attribute__((target("sse2")))
+static void classify_sse2(const char* block, BlockMasks& masks) {
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+
+    masks.quote = masks.backslash = masks.structural = 0;
+    for(int i = 0; i < 4; i++) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 16 * i));
+        const __m128i structural = _mm_or_si128(
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('{')), _mm_cmpeq_epi8(c, _mm_set1_epi8('}'))),
+                         _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8('[')), _mm_cmpeq_epi8(c, _mm_set1_epi8(']')))),
+            _mm_or_si128(_mm_cmpeq_epi8(c, _mm_set1_epi8(':')), _mm_cmpeq_epi8(c, _mm_set1_epi8(','))));
+
+        masks.quote      |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, quote))))     << (16 * i);
+        masks.backslash  |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(c, backslash)))) << (16 * i);
+        masks.structural |= static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(structural)))                    << (16 * i);
+    }
+}
+
+__attribute__((target("avx2")))
+static void classify_avx2(const char* block, BlockMasks& masks) {
+    const __m256i quote     = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+
+    masks.quote = masks.backslash = masks.structural = 0;
+    for(int i = 0; i < 2; i++) {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 32 * i));
+        const __m256i structural = _mm256_or_si256(
+            _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('{')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8('}'))),
+                            _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8('[')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8(']')))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(c, _mm256_set1_epi8(':')), _mm256_cmpeq_epi8(c, _mm256_set1_epi8(','))));
+
+        masks.quote      |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, quote))))     << (32 * i);
+        masks.backslash  |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(c, backslash)))) << (32 * i);
+        masks.structural |= static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(structural)))                      << (32 * i);
+    }
+}
+
+/// Control characters are those equal to their minimum with 0x1F
+__attribute__((target("sse2")))
+static const char* plain_sse2(const char* p, const char* end) {
+    const __m128i quote     = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control   = _mm_set1_epi8(0x1F);
+
+    while(end - p >= 16) {
+        const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        const __m128i special = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(c, quote), _mm_cmpeq_epi8(c, backslash)),
+                                             _mm_cmpeq_epi8(_mm_min_epu8(c, control), c));
+        const unsigned mask = _mm_movemask_epi8(special);
+        if(mask) return p + __builtin_ctz(mask);
+        p += 16;
+    }
+    return plain_scalar(p, end);
+}
+
+__attribute__((target("avx2")))
+static const char* plain_avx2(const char* p, const char* end) {
+    const __m256i quote     = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control   = _mm256_set1_epi8(0x1F);
+
+    while(end - p >= 32) {
+        const __m256i c = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        const __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(c, quote), _mm256_cmpeq_epi8(c, backslash)),
+                                                _mm256_cmpeq_epi8(_mm256_min_epu8(c, control), c));
+        const unsigned mask = _mm256_movemask_epi8(special);
+        if(mask) return p + __builtin_ctz(mask);
+        p += 32;
+    }
+    return plain_sse2(p, end);
+}
+
+#endif // VKAPI_SIMD_X86
+
+/* ##### Dispatch ##### */
+
+static SimdLevel detect_level() {
+#ifdef VKAPI_SIMD_X86
+    __builtin_cpu_init();
+    if(__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+    if(__builtin_cpu_supports("sse2")) return SIMD_SSE2;
+#endif
+    return SIMD_SCALAR;
+}
+
+static SimdLevel supported_level() {
+    static const SimdLevel level = detect_level();
+    return level;
+}
+
+/// Constant initialized, so scanning from static constructors of other units is safe
+static std::atomic<int> active(-1);
+
+SimdLevel
+simd_level() {
+    int level = active.load(std::memory_order_relaxed);
+    if(level < 0) {
+        level = supported_level();
+        active.store(level, std::memory_order_relaxed);
+    }
+    return static_cast<SimdLevel>(level);
+}
+
+const char*
+simd_level_name(SimdLevel level) {
+    switch(level) {
+    case SIMD_AVX2: return "avx2";
+    case SIMD_SSE2: return "sse2";
+    default:        return "scalar";
+    }
+}
+
+SimdLevel
+set_simd_level(SimdLevel level) {
+    const SimdLevel effective = (level < supported_level()) ? level : supported_level();
+    active.store(effective, std::memory_order_relaxed);
+    return effective;
+}
+
+static Classifier classifier() {
+    switch(simd_level()) {
+#ifdef VKAPI_SIMD_X86
+    case SIMD_AVX2: return classify_avx2;
+    case SIMD_SSE2: return classify_sse2;
+#endif
+    default:        return classify_scalar;
+    }
+}
+
+/* ##### Structure ##### */
+
+/// Characters preceded by an odd run of backslashes. A run may continue
+/// from the previous block, `carry` holds whether its first character is escaped.
+static inline uint64_t find_escaped(uint64_t backslash, uint64_t& carry) {
+    const uint64_t odd_bits = 0xAAAAAAAAAAAAAAAAULL;
+
+    if(!backslash) {
+        const uint64_t escaped = carry;
+        carry = 0;
+        return escaped;
+    }
+
+    /// Backslash escaped by the previous block can't start an escape
+    const uint64_t potential = backslash & ~carry;
+    /// Subtracting run starts from shifted runs flips parity bits where a run is odd
+    const uint64_t codes   = (((potential << 1) | odd_bits) - potential) ^ odd_bits;
+    const uint64_t escaped = codes ^ (backslash | carry);
+    carry = (codes & backslash) >> 63;
+    return escaped;
+}
+
+/// Bit i is the xor of bits 0..i
+static inline uint64_t prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+bool
+scan_structure(const char* data, size_t size, vector<uint32_t>& positions) {
+    const Classifier classify = classifier();
+
+    uint64_t escape_carry = 0;
+    uint64_t in_string    = 0;    ///< All ones while a string continues into the next block
+    char     tail[64];
+
+    positions.reserve(positions.size() + size / 8);
+    for(size_t base = 0; base < size; base += 64) {
+        const char* block = data + base;
+        if(size - base < 64) {
+            /// Pad the last block with spaces, they are neither structure nor string
+            memset(tail, ' ', sizeof(tail));
+            memcpy(tail, block, size - base);
+            block = tail;
+        }
+
+        BlockMasks masks;
+        classify(block, masks);
+
+        const uint64_t quote  = masks.quote & ~find_escaped(masks.backslash, escape_carry);
+        const uint64_t inside = prefix_xor(quote) ^ in_string;
+        in_string = static_cast<uint64_t>(static_cast<int64_t>(inside) >> 63);
+
+        for(uint64_t mask = (masks.structural & ~inside) | quote; mask; mask &= mask - 1) {
+            positions.push_back(static_cast<uint32_t>(base + __builtin_ctzll(mask)));
+        }
+    }
+    return in_string == 0;
+}
+
+const char*
+scan_plain(const char* p, const char* end) {
+    switch(simd_level()) {
+#ifdef VKAPI_SIMD_X86
+    case SIMD_AVX2: return plain_avx2(p, end);
+    case SIMD_SSE2: return plain_sse2(p, end);
+#endif
+    default:        return plain_scalar(p, end);
+    }
+}
+
+/* ##### Integers ##### */
+
+static inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+/// Value of eight ASCII digits loaded little-endian, in three multiplications
+static inline uint32_t eight_digits(uint64_t chunk) {
+    chunk -= 0x3030303030303030ULL;
+    chunk = (chunk * 10) + (chunk >> 8);
+    chunk = (((chunk & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32))) +
+             (((chunk >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32)))) >> 32;
+    return static_cast<uint32_t>(chunk);
+}
+
+bool
+scan_integer(const char* data, size_t size, uint64_t* magnitude, bool* negative) {
+    const char* p   = data;
+    const char* end = data + size;
+
+    *negative = (p < end && *p == '-');
+    if(*negative) p++;
+
+    const size_t digits = end - p;
+    if(digits == 0 || digits > 20) return false;
+    if(*p == '0' && digits > 1) return false;
+
+    uint64_t value = 0;
+    size_t   i     = 0;
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    /// Up to 19 digits can't overflow, 20 go through the checked loop
+    if(digits < 20) {
+        for(; i + 8 <= digits; i += 8) {
+            uint64_t chunk;
+            memcpy(&chunk, p + i, sizeof(chunk));
+            /// Every byte 0x30..0x39: high nibble 3 before and after adding 6
+            if((((chunk & 0xF0F0F0F0F0F0F0F0ULL) | (((chunk + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4))) != 0x3333333333333333ULL) {
+                return false;
+            }
+            value = value * 100000000 + eight_digits(chunk);
+        }
+    }
+#endif
+
+    for(; i < digits; i++) {
+        if(!is_digit(p[i])) return false;
+        const uint64_t digit = p[i] - '0';
+        if(value > (UINT64_MAX - digit) / 10) return false;
+        value = value * 10 + digit;
+    }
+
+    *magnitude = value;
+    return true;
+}
+
+}
@@ -0,0 +1,453 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "json_view.hpp"
+#include "json_scan.hpp"
+#include <stdlib.h>
+#include <limits.h>
+#include <math.h>
+
+namespace vk {
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+/// Receives the only event of a quoted string
+struct StringCollector : public JsonHandler {
+    string* out;
+    explicit StringCollector(string* out) : out(out) {}
+    bool String(StringRef value) { out->assign(value.data, value.size); return true; }
+};
+
+/// Unescape quoted string text through the event parser
+static string unescape(StringRef quoted) {
+    string result;
+    StringCollector collector(&result);
+    JsonPushParser::Parse(quoted.data, quoted.size, collector);
+    return result;
+}
+
+/* ##### JsonDocument ##### */
+
+JsonDocument::JsonDocument() : text(""), size(0) {
+    error = "empty document";
+}
+
+JsonDocument::JsonDocument(const char* data, size_t size) {
+    Reset(data, size);
+}
+
+JsonDocument::JsonDocument(const string& text) {
+    Reset(text.data(), text.size());
+}
+
+bool
+JsonDocument::Reset(const char* data, size_t size) {
+    this->text = data;
+    this->size = size;
+    tokens.clear();
+    match.clear();
+    entry.clear();
+    seps.clear();
+    error.clear();
+
+    if(size > UINT32_MAX) {
+        error = "document is too big to index";
+        return false;
+    }
+    return Index();
+}
+
+/// Only spaces in text[begin, end)
+static bool is_blank(const char* text, size_t begin, size_t end) {
+    for(size_t i = begin; i < end; i++) {
+        if(!is_space(text[i])) return false;
+    }
+    return true;
+}
+
+/// Text of a scalar in text[begin, end): one word, optionally surrounded by spaces
+static bool is_word(const char* text, size_t begin, size_t end) {
+    while(begin < end && is_space(text[begin]))   begin++;
+    while(end > begin && is_space(text[end - 1])) end--;
+    for(size_t i = begin; i < end; i++) {
+        if(is_space(text[i])) return false;
+    }
+    return begin < end;
+}
+
+bool
+JsonDocument::Index() {
+    if(!scan_structure(text, size, tokens)) {
+        error = "unterminated string at offset " + to_string(tokens.back());
+        return false;
+    }
+
+    /// What may come next, views walk the tokens relying on this grammar
+    enum Expect {
+        EXPECT_VALUE,
+        EXPECT_VALUE_OR_CLOSE,   ///< After '['
+        EXPECT_KEY,
+        EXPECT_KEY_OR_CLOSE,     ///< After '{'
+        EXPECT_COLON,
+        EXPECT_SEPARATOR         ///< After a value: ',' or closing bracket
+    };
+
+    match.assign(tokens.size(), 0);
+    entry.assign(tokens.size(), 0);
+    vector<uint32_t> stack;
+    vector<uint32_t> pending;   ///< Tokens before children of the open containers, innermost last
+    vector<uint32_t> firsts;    ///< Where each open container's children start in pending
+    Expect expect = EXPECT_VALUE;
+    size_t last   = 0;   ///< End of the previous token
+    for(size_t t = 0; t < tokens.size(); t++) {
+        const size_t pos   = tokens[t];
+        const char   c     = text[pos];
+        const size_t gap   = last;
+        const bool   blank = is_blank(text, gap, pos);
+        last = pos + 1;
+
+        /// Scalars have no tokens of their own, one is the text before the token ending it
+        if((expect == EXPECT_VALUE || expect == EXPECT_VALUE_OR_CLOSE) && !blank && is_word(text, gap, pos)) {
+            expect = EXPECT_SEPARATOR;
+        } else if(!blank) {
+            error = "unexpected value at offset " + to_string(gap);
+            return false;
+        }
+
+        const bool empty = (expect == EXPECT_VALUE_OR_CLOSE || expect == EXPECT_KEY_OR_CLOSE);
+        bool       ok    = false;
+        switch(expect) {
+        case EXPECT_VALUE_OR_CLOSE:
+        case EXPECT_VALUE:
+            if(c == '"') {
+                /// Quotes always come in pairs, the second one closes the string
+                last   = tokens[++t] + 1;
+                expect = EXPECT_SEPARATOR;
+                ok     = true;
+            } else if(c == '{' || c == '[') {
+                stack.push_back(t);
+                /// The bracket is taken as the token before the first child, dropped if there is none
+                firsts.push_back(pending.size());
+                pending.push_back(t);
+                expect = (c == '{') ? EXPECT_KEY_OR_CLOSE : EXPECT_VALUE_OR_CLOSE;
+                ok     = true;
+            } else {
+                ok = (c == ']' && expect == EXPECT_VALUE_OR_CLOSE);
+            }
+            break;
+        case EXPECT_KEY_OR_CLOSE:
+        case EXPECT_KEY:
+            if(c == '"') {
+                last   = tokens[++t] + 1;
+                expect = EXPECT_COLON;
+                ok     = true;
+            } else {
+                ok = (c == '}' && expect == EXPECT_KEY_OR_CLOSE);
+            }
+            break;
+        case EXPECT_COLON:
+            ok     = (c == ':');
+            expect = EXPECT_VALUE;
+            break;
+        case EXPECT_SEPARATOR:
+            if(c == ',' && !stack.empty()) {
+                expect = (text[tokens[stack.back()]] == '{') ? EXPECT_KEY : EXPECT_VALUE;
+                pending.push_back(t);
+                ok     = true;
+            } else {
+                ok = (c == '}' || c == ']');
+            }
+            break;
+        }
+
+        if(ok && (c == '}' || c == ']')) {
+            const char open = (c == '}') ? '{' : '[';
+            ok = !stack.empty() && text[tokens[stack.back()]] == open;
+            if(ok) {
+                const uint32_t opening = stack.back();
+                const size_t   first   = firsts.back() + (empty ? 1 : 0);
+                match[opening] = t;
+                entry[opening] = seps.size();
+                seps.push_back(pending.size() - first);
+                seps.insert(seps.end(), pending.begin() + first, pending.end());
+                pending.resize(firsts.back());
+                firsts.pop_back();
+                stack.pop_back();
+                expect = EXPECT_SEPARATOR;
+            }
+        }
+        if(!ok) {
+            error = string("unexpected '") + c + "' at offset " + to_string(pos);
+            return false;
+        }
+
+        /// Nothing may follow the root
+        if(stack.empty() && expect == EXPECT_SEPARATOR && t + 1 < tokens.size()) {
+            error = string("unexpected '") + text[tokens[t + 1]] + "' at offset " + to_string(tokens[t + 1]);
+            return false;
+        }
+    }
+
+    if(!stack.empty()) {
+        error = "unclosed '" + string(1, text[tokens[stack.back()]]) + "' at offset " + to_string(tokens[stack.back()]);
+        return false;
+    }
+
+    /// Whatever is left is a scalar root or trailing spaces
+    const bool blank = is_blank(text, last, size);
+    if(expect == EXPECT_VALUE && blank) {
+        error = "empty document";
+        return false;
+    }
+    if((expect == EXPECT_VALUE && !is_word(text, last, size)) || (expect == EXPECT_SEPARATOR && !blank)) {
+        error = "unexpected value at offset " + to_string(last);
+        return false;
+    }
+    return true;
+}
+
+JsonView
+JsonDocument::getRoot() const {
+    if(!isValid()) return JsonView();
+
+    size_t pos = 0;
+    while(is_space(text[pos])) pos++;
+    return JsonView(this, 0, pos);
+}
+
+bool
+JsonDocument::isValid() const {
+    return error.empty();
+}
+
+const string&
+JsonDocument::getError() const {
+    return error;
+}
+
+size_t
+JsonDocument::getTokens() const {
+    return tokens.size();
+}
+
+/* ##### JsonView ##### */
+
+JsonView::JsonView() : doc(nullptr), tok(0), pos(0) {}
+
+JsonView
+JsonView::After(const JsonDocument* doc, size_t sep) {
+    if(sep >= doc->tokens.size()) return JsonView();
+
+    size_t pos = doc->tokens[sep] + 1;
+    while(pos < doc->size && is_space(doc->text[pos])) pos++;
+    if(pos >= doc->size) return JsonView();
+    return JsonView(doc, sep + 1, pos);
+}
+
+size_t
+JsonView::Next() const {
+    switch(First()) {
+    case '{':
+    case '[': return doc->match[tok] + 1;
+    case '"': return tok + 2;
+    default:  return tok;
+    }
+}
+
+JsonView::Type
+JsonView::type() const {
+    if(!doc) return MISSING;
+
+    switch(First()) {
+    case '{': return OBJECT;
+    case '[': return ARRAY;
+    case '"': return STRING;
+    case 't':
+    case 'f': return BOOL;
+    case 'n': return NULL_VALUE;
+    default:  return NUMBER;
+    }
+}
+
+JsonView::Iterator
+JsonView::begin() const {
+    if(!isArray() && !isObject()) return end();
+
+    /// Empty container: nothing but spaces before the closing bracket
+    if(After(doc, tok).pos == doc->tokens[doc->match[tok]]) return end();
+    return Iterator(doc, tok, isObject());
+}
+
+JsonView::Iterator
+JsonView::end() const {
+    if(!isArray() && !isObject()) return Iterator(doc, SIZE_MAX, false);
+    return Iterator(doc, doc->match[tok], isObject());
+}
+
+JsonView
+JsonView::Iterator::operator*() const {
+    /// Object member is: sep, key quotes, colon, value
+    return JsonView::After(doc, object ? sep + 3 : sep);
+}
+
+StringRef
+JsonView::Iterator::key() const {
+    if(!object) return StringRef();
+    const uint32_t open  = doc->tokens[sep + 1];
+    const uint32_t close = doc->tokens[sep + 2];
+    return StringRef(doc->text + open + 1, close - open - 1);
+}
+
+string
+JsonView::Iterator::name() const {
+    StringRef raw = key();
+    if(!memchr(raw.data, '\\', raw.size)) return raw.str();
+    return unescape(StringRef(raw.data - 1, raw.size + 2));
+}
+
+JsonView::Iterator&
+JsonView::Iterator::operator++() {
+    JsonView value = **this;
+    if(!value.exists()) {
+        /// Broken member, jump to the end of the container
+        while(sep < doc->tokens.size() && doc->text[doc->tokens[sep]] != '}' && doc->text[doc->tokens[sep]] != ']') sep++;
+        return *this;
+    }
+
+    /// Next is either a comma before the next element or the closing bracket
+    sep = value.Next();
+    return *this;
+}
+
+JsonView
+JsonView::operator[](StringRef key) const {
+    if(!isObject()) return JsonView();
+
+    const bool escaped_key = memchr(key.data, '\\', key.size) != nullptr;
+    for(Iterator it = begin(), last = end(); it != last; ++it) {
+        StringRef raw = it.key();
+        if(raw == key) return *it;
+        /// Escaped names are rare, compare those the slow way
+        if(!escaped_key && memchr(raw.data, '\\', raw.size) && it.name() == key.str()) return *it;
+    }
+    return JsonView();
+}
+
+JsonView
+JsonView::operator[](size_t index) const {
+    if(!isArray()) return JsonView();
+
+    const uint32_t* children = &doc->seps[doc->entry[tok]];
+    if(index >= children[0]) return JsonView();
+    return After(doc, children[1 + index]);
+}
+
+size_t
+JsonView::size() const {
+    if(!isArray() && !isObject()) return 0;
+    return doc->seps[doc->entry[tok]];
+}
+
+StringRef
+JsonView::getRaw() const {
+    if(!doc) return StringRef();
+
+    size_t last;
+    switch(First()) {
+    case '{':
+    case '[': last = doc->tokens[doc->match[tok]] + 1; break;
+    case '"': last = doc->tokens[tok + 1] + 1;         break;
+    default:
+        last = (tok < doc->tokens.size()) ? doc->tokens[tok] : doc->size;
+        while(last > pos && is_space(doc->text[last - 1])) last--;
+        break;
+    }
+    return StringRef(doc->text + pos, last - pos);
+}
+
+bool
+JsonView::asBool(bool def) const {
+    if(!isBool()) return def;
+    return First() == 't';
+}
+
+int
+JsonView::asInt(int def) const {
+    int64_t value = asInt64(def);
+    return (value < INT_MIN || value > INT_MAX) ? def : static_cast<int>(value);
+}
+
+int64_t
+JsonView::asInt64(int64_t def) const {
+    if(!isNumber()) return def;
+
+    StringRef raw = getRaw();
+    uint64_t  magnitude;
+    bool      negative;
+    /// Fraction, exponent or too big: take the long way, casting an out of range double is undefined
+    if(!scan_integer(raw.data, raw.size, &magnitude, &negative)) {
+        const double value = asDouble(NAN);
+        return (value >= -9223372036854775808.0 && value < 9223372036854775808.0) ? static_cast<int64_t>(value) : def;
+    }
+
+    if(negative) return (magnitude <= static_cast<uint64_t>(INT64_MAX) + 1) ? static_cast<int64_t>(0 - magnitude) : def;
+    return (magnitude <= static_cast<uint64_t>(INT64_MAX)) ? static_cast<int64_t>(magnitude) : def;
+}
+
+uint64_t
+JsonView::asUInt64(uint64_t def) const {
+    if(!isNumber()) return def;
+
+    StringRef raw = getRaw();
+    uint64_t  magnitude;
+    bool      negative;
+    if(!scan_integer(raw.data, raw.size, &magnitude, &negative)) {
+        const double value = asDouble(NAN);
+        return (value >= 0 && value < 18446744073709551616.0) ? static_cast<uint64_t>(value) : def;
+    }
+    return negative ? def : magnitude;
+}
+
+ID
+JsonView::asID(ID def) const {
+    return static_cast<ID>(asInt64(def));
+}
+
+double
+JsonView::asDouble(double def) const {
+    if(!isNumber()) return def;
+
+    StringRef raw = getRaw();
+    char buf[64];
+    if(raw.size == 0 || raw.size >= sizeof(buf)) return def;
+    memcpy(buf, raw.data, raw.size);
+    buf[raw.size] = '\0';
+
+    char* end;
+    double value = strtod(buf, &end);
+    return (end == buf + raw.size) ? value : def;
+}
+
+string
+JsonView::asString(const string& def) const {
+    if(!isString()) return def;
+
+    StringRef raw = getRaw();
+    if(!memchr(raw.data, '\\', raw.size)) return string(raw.data + 1, raw.size - 2);
+    return unescape(raw);
+}
+
+VKValue
+JsonView::toValue() const {
+    VKValue value;
+    if(!doc) return value;
+
+    StringRef raw = getRaw();
+    Reader reader;
+    if(!reader.parse(raw.data, raw.data + raw.size, value, false)) value = VKValue();
+    return value;
+}
+
+}
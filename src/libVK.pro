@@ -17,6 +17,7 @@ QMAKE_CXX = ccache $${QMAKE_CXX}
 
 DEFINES += BACKWARD_HAS_BFD=1
 DEFINES += BACKWARD_HAS_DW=1
+#DEFINES += VKAPI_JSON_BACKEND=JSON_BACKEND_VIEW
 
 LIBS += -lcurl -lssl -lcrypto -lssl -lcrypto -llber -lldap -lz
 LIBS += -lbfd -ldw
@@ -31,12 +32,51 @@ SOURCES += \
     to_string.cpp \
     init.cpp \
     vkexception.cpp \
+    retry.cpp \
+    timeout.cpp \
+    circuit_breaker.cpp \
+    single_flight.cpp \
+    rate_limiter.cpp \
+    scheduler.cpp \
+    shared_rate_limiter.cpp \
+    quota.cpp \
+    concurrency.cpp \
+    async.cpp \
+    sax.cpp \
+    json_view.cpp \
+    json_scan.cpp \
+    arena.cpp \
+    intern.cpp \
+    item_stream.cpp \
+    columns.cpp \
+    json_pointer.cpp \
+    response.cpp \
     third-party/backward.cpp
 
 HEADERS += \
     include/vkapi.hpp \
     include/types.hpp \
     include/string_utils.hpp \
-    include/log.hpp
+    include/log.hpp \
+    include/retry.hpp \
+    include/timeout.hpp \
+    include/request_context.hpp \
+    include/circuit_breaker.hpp \
+    include/single_flight.hpp \
+    include/rate_limiter.hpp \
+    include/scheduler.hpp \
+    include/shared_rate_limiter.hpp \
+    include/quota.hpp \
+    include/concurrency.hpp \
+    include/async.hpp \
+    include/sax.hpp \
+    include/json_view.hpp \
+    include/json_scan.hpp \
+    include/arena.hpp \
+    include/intern.hpp \
+    include/item_stream.hpp \
+    include/columns.hpp \
+    include/json_pointer.hpp \
+    include/response.hpp
 
 
@@ -0,0 +1,181 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "quota.hpp"
+#include "vkapi.hpp"
+#include <ctype.h>
+#include <algorithm>
+
+namespace vk {
+
+/// VK runs at most that many calls of one execute
+#define EXECUTE_MAX_CALLS 25
+
+QuotaPolicy::QuotaPolicy(TokenType type)
+    : type(type), requests(0), calls(0) {
+    /// Defaults from VK docs: community tokens are allowed more than user and service ones
+    rates[TOKEN_USER]    = 3;
+    rates[TOKEN_GROUP]   = 20;
+    rates[TOKEN_SERVICE] = 3;
+}
+
+void
+QuotaPolicy::Roll(Limit& limit, steady_clock::time_point now) {
+    if(limit.used == 0 || now - limit.window_start >= limit.period) {
+        limit.used         = 0;
+        limit.window_start = now;
+    }
+}
+
+StrArray
+QuotaPolicy::Calls(const string& method, const Args& arguments) {
+    StrArray methods;
+    if(method == "execute") {
+        auto code = arguments.find("code");
+        if(code != arguments.end()) methods = ExecuteCalls(code->second);
+    }
+    /// Plain method, or stored procedure whose calls we can't see
+    if(methods.empty()) methods.push_back(method);
+    return methods;
+}
+
+void
+QuotaPolicy::Charge(const string& method, const Args& arguments) {
+    const StrArray methods = Calls(method, arguments);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    const steady_clock::time_point now = steady_clock::now();
+
+    /// Check every cap before charging any, a rejected execute costs nothing
+    map<string, uint32_t> wanted;
+    for(const string& m : methods) wanted[m]++;
+    for(const auto& w : wanted) {
+        auto it = limits.find(w.first);
+        if(it == limits.end()) continue;
+
+        Limit& limit = it->second;
+        Roll(limit, now);
+        if(limit.used + w.second > limit.limit) {
+            throw QuotaExceededException("quota of " + w.first + " is exhausted: "
+                                         + to_string(limit.used) + " of " + to_string(limit.limit) + " used");
+        }
+    }
+
+    for(const auto& w : wanted) {
+        auto it = limits.find(w.first);
+        if(it != limits.end()) it->second.used += w.second;
+    }
+    requests++;
+    calls += methods.size();
+}
+
+void
+QuotaPolicy::Refund(const string& method, const Args& arguments) {
+    const StrArray methods = Calls(method, arguments);
+
+    std::lock_guard<std::mutex> lock(mtx);
+    for(const string& m : methods) {
+        /// A window that rolled over since the charge has nothing to give back
+        auto it = limits.find(m);
+        if(it != limits.end() && it->second.used > 0) it->second.used--;
+    }
+    if(requests > 0) requests--;
+    calls -= std::min<uint64_t>(calls, methods.size());
+}
+
+StrArray
+QuotaPolicy::ExecuteCalls(const string& code) {
+    StrArray methods;
+    static const string prefix = "API.";
+
+    for(size_t pos = code.find(prefix); pos != string::npos; pos = code.find(prefix, pos)) {
+        /// Skip identifiers merely ending with "API"
+        if(pos > 0 && (isalnum(static_cast<unsigned char>(code[pos - 1])) || code[pos - 1] == '_')) {
+            pos += prefix.size();
+            continue;
+        }
+        pos += prefix.size();
+
+        size_t end = pos;
+        while(end < code.size() && (isalnum(static_cast<unsigned char>(code[end])) || code[end] == '_' || code[end] == '.')) {
+            end++;
+        }
+        if(end > pos) methods.push_back(code.substr(pos, end - pos));
+        pos = end;
+
+        if(methods.size() == EXECUTE_MAX_CALLS) break;
+    }
+    return methods;
+}
+
+void
+QuotaPolicy::SetTokenType(TokenType type) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->type = type;
+}
+
+void
+QuotaPolicy::SetRate(TokenType type, double rate) {
+    std::lock_guard<std::mutex> lock(mtx);
+    rates[type] = rate;
+}
+
+void
+QuotaPolicy::SetMethodLimit(const string& method, uint32_t limit, milliseconds period) {
+    std::lock_guard<std::mutex> lock(mtx);
+    if(limit == 0) {
+        limits.erase(method);
+        return;
+    }
+    Limit& l = limits[method];
+    l.limit  = limit;
+    l.period = period;
+}
+
+TokenType
+QuotaPolicy::getTokenType() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return type;
+}
+
+double
+QuotaPolicy::getRate() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return rates[type];
+}
+
+uint64_t
+QuotaPolicy::getRequests() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return requests;
+}
+
+uint64_t
+QuotaPolicy::getCalls() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return calls;
+}
+
+uint32_t
+QuotaPolicy::getUsed(const string& method) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = limits.find(method);
+    if(it == limits.end()) return 0;
+
+    Limit limit = it->second;
+    Roll(limit, steady_clock::now());
+    return limit.used;
+}
+
+uint32_t
+QuotaPolicy::getRemaining(const string& method) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = limits.find(method);
+    if(it == limits.end()) return UINT32_MAX;
+
+    Limit limit = it->second;
+    Roll(limit, steady_clock::now());
+    return limit.limit - limit.used;
+}
+
+}
@@ -0,0 +1,174 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "rate_limiter.hpp"
+#include "types.hpp"
+#include "log.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace vk {
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+
+TokenBucket::TokenBucket(double rate, double burst)
+    : rate(rate), burst(std::max(burst, 1.0)), tokens(std::max(burst, 1.0)),
+      last_refill(steady_clock::now()) {}
+
+void
+TokenBucket::Refill(steady_clock::time_point now) {
+    double elapsed = duration_cast<duration<double>>(now - last_refill).count();
+    tokens         = std::min(burst, tokens + elapsed * rate);
+    last_refill    = now;
+}
+
+bool
+TokenBucket::TryAcquire(double cost, milliseconds* wait) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Refill(steady_clock::now());
+
+    if(tokens >= cost) {
+        tokens -= cost;
+        return true;
+    }
+
+    if(wait) {
+        double missing = cost - tokens;
+        *wait = (rate > 0) ? milliseconds(static_cast<milliseconds::rep>(std::ceil(missing / rate * 1000.0)))
+                           : milliseconds(1000);
+    }
+    return false;
+}
+
+void
+TokenBucket::SetRate(double rate, double burst) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Refill(steady_clock::now());
+    this->rate   = rate;
+    this->burst  = std::max(burst, 1.0);
+    this->tokens = std::min(this->tokens, this->burst);
+}
+
+double
+TokenBucket::getRate() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return rate;
+}
+
+double
+TokenBucket::getBurst() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return burst;
+}
+
+/* ##### AdaptiveRateLimiter ##### */
+
+/// Latency samples needed before spikes are judged
+#define ADAPTIVE_MIN_SAMPLES  20
+#define ADAPTIVE_EWMA_ALPHA   0.1
+/// Spikes still pull the baseline, slowly, so a lasting latency shift stops being one
+#define ADAPTIVE_SPIKE_ALPHA  0.02
+/// Lowest min_rate accepted, additive increase divides by the rate
+#define ADAPTIVE_RATE_FLOOR   0.01
+
+AdaptiveRateLimiter::AdaptiveRateLimiter(double initial_rate, double min_rate, double max_rate)
+    : bucket(initial_rate), rate(initial_rate), min_rate(std::max(min_rate, ADAPTIVE_RATE_FLOOR)), max_rate(max_rate),
+      increase(1.0), decrease(0.5), cooldown(1000), spike_factor(4.0),
+      baseline(0), samples(0), throttled(0), decreases(0),
+      last_decrease(steady_clock::now() - cooldown) {
+    this->max_rate = std::max(this->max_rate, this->min_rate);
+    rate           = std::min(std::max(rate, this->min_rate), this->max_rate);
+    bucket.SetRate(rate, 1.0);
+}
+
+bool
+AdaptiveRateLimiter::TryAcquire(double cost, milliseconds* wait) {
+    return bucket.TryAcquire(cost, wait);
+}
+
+void
+AdaptiveRateLimiter::Feedback(milliseconds latency, bool throttled) {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    if(throttled) {
+        this->throttled++;
+        Decrease("throttled by VK");
+        return;
+    }
+
+    const double ms = static_cast<double>(latency.count());
+    if(spike_factor > 0 && samples >= ADAPTIVE_MIN_SAMPLES && ms > baseline * spike_factor) {
+        baseline += ADAPTIVE_SPIKE_ALPHA * (ms - baseline);
+        Decrease("latency spike");
+        return;
+    }
+
+    baseline = samples ? baseline + ADAPTIVE_EWMA_ALPHA * (ms - baseline) : ms;
+    samples++;
+
+    /// rate successes a second, so +increase a second
+    double new_rate = std::min(max_rate, rate + increase / rate);
+    if(new_rate != rate) {
+        rate = new_rate;
+        bucket.SetRate(rate, 1.0);
+    }
+}
+
+void
+AdaptiveRateLimiter::Decrease(const char* reason) {
+    steady_clock::time_point now = steady_clock::now();
+    if(now - last_decrease < cooldown) return;
+
+    last_decrease = now;
+    decreases++;
+    rate = std::max(min_rate, rate * decrease);
+    bucket.SetRate(rate, 1.0);
+
+    LOG2() << reason << ", rate limit is " << rate << " rps now";
+}
+
+void
+AdaptiveRateLimiter::SetIncrease(double increase) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->increase = increase;
+}
+
+void
+AdaptiveRateLimiter::SetDecrease(double decrease, milliseconds cooldown) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->decrease = decrease;
+    this->cooldown = cooldown;
+}
+
+void
+AdaptiveRateLimiter::SetSpikeFactor(double spike_factor) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->spike_factor = spike_factor;
+}
+
+double
+AdaptiveRateLimiter::getRate() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return rate;
+}
+
+double
+AdaptiveRateLimiter::getBaseline() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return baseline;
+}
+
+uint64_t
+AdaptiveRateLimiter::getThrottled() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return throttled;
+}
+
+uint64_t
+AdaptiveRateLimiter::getDecreases() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return decreases;
+}
+
+}
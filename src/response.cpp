@@ -0,0 +1,287 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include <limits.h>
+
+#include "response.hpp"
+
+namespace vk {
+
+ResponseValue::ResponseValue() : backend(JSON_BACKEND_JSONCPP), json(nullptr) {}
+
+ResponseValue::ResponseValue(const VKValue* json) : backend(JSON_BACKEND_JSONCPP), json(json) {}
+
+ResponseValue::ResponseValue(const JsonView& view) : backend(JSON_BACKEND_VIEW), json(nullptr), view(view) {}
+
+ResponseValue::ResponseValue(const ArenaValue& arena) : backend(JSON_BACKEND_ARENA), json(nullptr), arena(arena) {}
+
+ResponseValue::Type
+ResponseValue::type() const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.type();
+    case JSON_BACKEND_ARENA: return arena.type();
+    default:                 break;
+    }
+
+    if(!json) return JsonView::MISSING;
+    switch(json->type()) {
+    case nullValue:    return JsonView::NULL_VALUE;
+    case booleanValue: return JsonView::BOOL;
+    case stringValue:  return JsonView::STRING;
+    case arrayValue:   return JsonView::ARRAY;
+    case objectValue:  return JsonView::OBJECT;
+    default:           return JsonView::NUMBER;
+    }
+}
+
+ResponseValue
+ResponseValue::operator[](StringRef key) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view[key];
+    case JSON_BACKEND_ARENA: return arena[key];
+    default:                 break;
+    }
+    if(!isObject()) return ResponseValue();
+    return ResponseValue(json->find(key.data, key.data + key.size));
+}
+
+ResponseValue
+ResponseValue::operator[](size_t index) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view[index];
+    case JSON_BACKEND_ARENA: return arena[index];
+    default:                 break;
+    }
+    if(!isArray() || index >= json->size()) return ResponseValue();
+    return ResponseValue(&(*json)[static_cast<ArrayIndex>(index)]);
+}
+
+size_t
+ResponseValue::size() const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.size();
+    case JSON_BACKEND_ARENA: return arena.size();
+    default:                 break;
+    }
+    return (isArray() || isObject()) ? json->size() : 0;
+}
+
+bool
+ResponseValue::asBool(bool def) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.asBool(def);
+    case JSON_BACKEND_ARENA: return arena.asBool(def);
+    default:                 break;
+    }
+    return isBool() ? json->asBool() : def;
+}
+
+int
+ResponseValue::asInt(int def) const {
+    int64_t value = asInt64(def);
+    return (value < INT_MIN || value > INT_MAX) ? def : static_cast<int>(value);
+}
+
+int64_t
+ResponseValue::asInt64(int64_t def) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.asInt64(def);
+    case JSON_BACKEND_ARENA: return arena.asInt64(def);
+    default:                 break;
+    }
+    if(!isNumber()) return def;
+
+    /// Fractions are truncated like the other backends do, out of range gives def
+    if(json->isInt64()) return json->asInt64();
+    if(json->type() != realValue) return def;
+    const double value = json->asDouble();
+    return (value >= -9223372036854775808.0 && value < 9223372036854775808.0) ? static_cast<int64_t>(value) : def;
+}
+
+uint64_t
+ResponseValue::asUInt64(uint64_t def) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.asUInt64(def);
+    case JSON_BACKEND_ARENA: return arena.asUInt64(def);
+    default:                 break;
+    }
+    if(!isNumber()) return def;
+
+    if(json->isUInt64()) return json->asUInt64();
+    if(json->type() != realValue) return def;
+    const double value = json->asDouble();
+    return (value >= 0 && value < 18446744073709551616.0) ? static_cast<uint64_t>(value) : def;
+}
+
+ID
+ResponseValue::asID(ID def) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.asID(def);
+    case JSON_BACKEND_ARENA: return arena.asID(def);
+    default:                 return static_cast<ID>(asInt64(def));
+    }
+}
+
+double
+ResponseValue::asDouble(double def) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.asDouble(def);
+    case JSON_BACKEND_ARENA: return arena.asDouble(def);
+    default:                 break;
+    }
+    return isNumber() ? json->asDouble() : def;
+}
+
+string
+ResponseValue::asString(const string& def) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.asString(def);
+    case JSON_BACKEND_ARENA: return arena.asString(def);
+    default:                 break;
+    }
+    return isString() ? json->asString() : def;
+}
+
+VKValue
+ResponseValue::toValue() const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.toValue();
+    case JSON_BACKEND_ARENA: return arena.toValue();
+    default:                 break;
+    }
+    return json ? *json : VKValue();
+}
+
+ResponseValue::Iterator
+ResponseValue::begin() const {
+    Iterator it(backend);
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  it.view  = view.begin();  break;
+    case JSON_BACKEND_ARENA: it.arena = arena.begin(); break;
+    default:
+        if(isArray() || isObject()) it.json = json->begin();
+        break;
+    }
+    return it;
+}
+
+ResponseValue::Iterator
+ResponseValue::end() const {
+    Iterator it(backend);
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  it.view  = view.end();  break;
+    case JSON_BACKEND_ARENA: it.arena = arena.end(); break;
+    default:
+        if(isArray() || isObject()) it.json = json->end();
+        break;
+    }
+    return it;
+}
+
+ResponseValue
+ResponseValue::Iterator::operator*() const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return *view;
+    case JSON_BACKEND_ARENA: return *arena;
+    default:                 return ResponseValue(&*json);
+    }
+}
+
+string
+ResponseValue::Iterator::name() const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view.name();
+    case JSON_BACKEND_ARENA: return arena.key().str();
+    default:                 return json.name();
+    }
+}
+
+ResponseValue::Iterator&
+ResponseValue::Iterator::operator++() {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  ++view;  break;
+    case JSON_BACKEND_ARENA: ++arena; break;
+    default:                 ++json;  break;
+    }
+    return *this;
+}
+
+bool
+ResponseValue::Iterator::operator==(const Iterator& other) const {
+    switch(backend) {
+    case JSON_BACKEND_VIEW:  return view == other.view;
+    case JSON_BACKEND_ARENA: return arena == other.arena;
+    default:                 return json == other.json;
+    }
+}
+
+Response::Response(JsonBackend backend) : backend(backend), parsed(backend) {}
+
+bool
+Response::Parse(const char* data, size_t size) {
+    Clear();
+
+    switch(parsed) {
+    case JSON_BACKEND_VIEW:
+        text.assign(data, size);
+        if(!view.Reset(text.data(), text.size())) error = view.getError();
+        break;
+    case JSON_BACKEND_ARENA:
+        if(!arena.Parse(data, size)) error = arena.getError();
+        break;
+    default: {
+        Reader reader;
+        if(!reader.parse(data, data + size, json, false)) error = reader.getFormattedErrorMessages();
+        break;
+    }
+    }
+    return error.empty();
+}
+
+bool
+Response::Parse(const string& text) {
+    return Parse(text.data(), text.size());
+}
+
+void
+Response::SetBackend(JsonBackend backend) {
+    this->backend = backend;
+}
+
+ResponseValue
+Response::getRoot() const {
+    if(!error.empty()) return ResponseValue();
+
+    switch(parsed) {
+    case JSON_BACKEND_VIEW:  return view.isValid() ? ResponseValue(view.getRoot()) : ResponseValue();
+    case JSON_BACKEND_ARENA: return arena.getRoot();
+    default:                 return ResponseValue(&json);
+    }
+}
+
+JsonBackend
+Response::getBackend() const {
+    return parsed;
+}
+
+JsonBackend
+Response::getConfiguredBackend() const {
+    return backend;
+}
+
+const string&
+Response::getError() const {
+    return error;
+}
+
+void
+Response::Clear() {
+    json = VKValue();
+    view = JsonDocument();
+    text.clear();
+    arena.Clear();
+    error.clear();
+    parsed = backend;
+}
+
+}
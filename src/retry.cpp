@@ -0,0 +1,172 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "retry.hpp"
+#include "vkapi.hpp"
+#include "log.hpp"
+#include <algorithm>
+
+namespace vk {
+
+using std::chrono::duration;
+using std::chrono::duration_cast;
+
+/* ##### RetryBudget ##### */
+
+RetryBudget::RetryBudget(double ratio, double min_per_sec, double max_balance)
+    : ratio(ratio), min_per_sec(min_per_sec), max_balance(max_balance),
+      balance(max_balance), last_refill(steady_clock::now()) {}
+
+void
+RetryBudget::Refill() {
+    steady_clock::time_point now = steady_clock::now();
+    double elapsed = duration_cast<duration<double>>(now - last_refill).count();
+    balance        = std::min(max_balance, balance + elapsed * min_per_sec);
+    last_refill    = now;
+}
+
+void
+RetryBudget::Deposit() {
+    std::lock_guard<std::mutex> lock(mtx);
+    Refill();
+    balance = std::min(max_balance, balance + ratio);
+}
+
+bool
+RetryBudget::Withdraw() {
+    std::lock_guard<std::mutex> lock(mtx);
+    Refill();
+    if(balance < 1.0) return false;
+    balance -= 1.0;
+    return true;
+}
+
+double
+RetryBudget::getBalance() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return balance;
+}
+
+/* ##### RetryPolicy ##### */
+
+RetryPolicy::RetryPolicy()
+    : max_retries(3),
+      base_delay(100),
+      max_delay(5000),
+      curl_codes({
+          CURLE_COULDNT_RESOLVE_HOST,
+          CURLE_COULDNT_CONNECT
+      }),
+      vk_codes({
+          RESULT_TOO_MANY_REQUESTS,
+          RESULT_TOO_MANY_SIMILAR_REQUESTS
+      }),
+      idempotent_curl_codes({
+          CURLE_OPERATION_TIMEDOUT,
+          CURLE_SEND_ERROR,
+          CURLE_RECV_ERROR,
+          CURLE_GOT_NOTHING,
+          CURLE_PARTIAL_FILE
+      }),
+      idempotent_vk_codes({
+          RESULT_INTERNAL_ERROR
+      }),
+      budget(std::make_shared<RetryBudget>()),
+      rng(std::random_device{}()) {}
+
+bool
+RetryPolicy::Allow(size_t attempt) {
+    if(attempt >= max_retries) return false;
+    if(budget && !budget->Withdraw()) {
+        LOG1() << "retry budget exhausted, giving up";
+        return false;
+    }
+    return true;
+}
+
+bool
+RetryPolicy::ShouldRetry(CURLcode code, size_t attempt, bool idempotent) {
+    if(curl_codes.find(code) == curl_codes.end() &&
+       (!idempotent || idempotent_curl_codes.find(code) == idempotent_curl_codes.end())) return false;
+    return Allow(attempt);
+}
+
+bool
+RetryPolicy::ShouldRetry(int vk_code, size_t attempt, bool idempotent) {
+    if(vk_codes.find(vk_code) == vk_codes.end() &&
+       (!idempotent || idempotent_vk_codes.find(vk_code) == idempotent_vk_codes.end())) return false;
+    return Allow(attempt);
+}
+
+milliseconds
+RetryPolicy::Backoff(size_t attempt, milliseconds floor) {
+    /// Full jitter: uniform in [0, min(max_delay, base_delay * 2^attempt)]
+    milliseconds::rep cap = base_delay.count() << std::min<size_t>(attempt, 20);
+    cap = std::min(cap, max_delay.count());
+
+    std::uniform_int_distribution<milliseconds::rep> dist(0, std::max<milliseconds::rep>(cap, 0));
+    return std::max(milliseconds(dist(rng)), floor);
+}
+
+void
+RetryPolicy::OnRequest() {
+    if(budget) budget->Deposit();
+}
+
+void
+RetryPolicy::SetMaxRetries(size_t max_retries) {
+    this->max_retries = max_retries;
+}
+
+void
+RetryPolicy::SetBackoff(milliseconds base_delay, milliseconds max_delay) {
+    this->base_delay = base_delay;
+    this->max_delay  = max_delay;
+}
+
+void
+RetryPolicy::SetRetryableCurlCodes(const std::set<CURLcode>& codes) {
+    this->curl_codes = codes;
+}
+
+void
+RetryPolicy::SetRetryableVKCodes(const std::set<int>& codes) {
+    this->vk_codes = codes;
+}
+
+void
+RetryPolicy::SetIdempotentCurlCodes(const std::set<CURLcode>& codes) {
+    this->idempotent_curl_codes = codes;
+}
+
+void
+RetryPolicy::SetIdempotentVKCodes(const std::set<int>& codes) {
+    this->idempotent_vk_codes = codes;
+}
+
+void
+RetryPolicy::SetBudget(const std::shared_ptr<RetryBudget>& budget) {
+    this->budget = budget;
+}
+
+size_t
+RetryPolicy::getMaxRetries() const {
+    return max_retries;
+}
+
+milliseconds
+RetryPolicy::getBaseDelay() const {
+    return base_delay;
+}
+
+milliseconds
+RetryPolicy::getMaxDelay() const {
+    return max_delay;
+}
+
+const std::shared_ptr<RetryBudget>&
+RetryPolicy::getBudget() const {
+    return budget;
+}
+
+}
@@ -0,0 +1,482 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "sax.hpp"
+#include "json_scan.hpp"
+#include <stdlib.h>
+#include <ctype.h>
+
+namespace vk {
+
+static inline bool is_space(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+static inline bool is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+/// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool valid_number(StringRef s) {
+    const char* p   = s.data;
+    const char* end = s.data + s.size;
+
+    if(p < end && *p == '-') p++;
+    if(p == end) return false;
+    if(*p == '0') {
+        p++;
+    } else if(*p >= '1' && *p <= '9') {
+        while(p < end && *p >= '0' && *p <= '9') p++;
+    } else {
+        return false;
+    }
+
+    if(p < end && *p == '.') {
+        const char* digits = ++p;
+        while(p < end && *p >= '0' && *p <= '9') p++;
+        if(p == digits) return false;
+    }
+
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        p++;
+        if(p < end && (*p == '+' || *p == '-')) p++;
+        const char* digits = p;
+        while(p < end && *p >= '0' && *p <= '9') p++;
+        if(p == digits) return false;
+    }
+    return p == end;
+}
+
+JsonPushParser::JsonPushParser(JsonHandler& handler, size_t max_depth)
+    : handler(handler), max_depth(max_depth) {
+    Reset();
+}
+
+void
+JsonPushParser::Reset() {
+    stack.clear();
+    scratch.clear();
+    error.clear();
+    state           = EXPECT_VALUE;
+    token           = TOKEN_NONE;
+    buffered        = false;
+    is_key          = false;
+    in_escape       = false;
+    escape_len      = 0;
+    high_surrogate  = 0;
+    literal         = nullptr;
+    literal_matched = 0;
+    stopped         = false;
+    consumed        = 0;
+    chunk           = nullptr;
+}
+
+bool
+JsonPushParser::Feed(const char* data, size_t size) {
+    if(stopped || !error.empty()) return false;
+
+    chunk = data;
+    const char* p   = data;
+    const char* end = data + size;
+
+    while(p < end) {
+        bool ok = true;
+        switch(token) {
+        case TOKEN_STRING:  ok = ContinueString(p, end);  break;
+        case TOKEN_NUMBER:  ok = ContinueNumber(p, end);  break;
+        case TOKEN_LITERAL: ok = ContinueLiteral(p, end); break;
+        case TOKEN_NONE:
+            if(is_space(*p)) {
+                p++;
+                break;
+            }
+
+            switch(state) {
+            case EXPECT_VALUE_OR_END:
+                if(*p == ']') {
+                    ok = EndContainer(*p++);
+                    break;
+                }
+                ok = BeginValue(p);
+                break;
+            case EXPECT_VALUE:
+                ok = BeginValue(p);
+                break;
+            case EXPECT_KEY_OR_END:
+                if(*p == '}') {
+                    ok = EndContainer(*p++);
+                    break;
+                }
+                /* fall through */
+            case EXPECT_KEY:
+                if(*p != '"') return Fail(p, "expected object key");
+                p++;
+                token    = TOKEN_STRING;
+                is_key   = true;
+                buffered = false;
+                break;
+            case EXPECT_COLON:
+                if(*p != ':') return Fail(p, "expected ':'");
+                p++;
+                state = EXPECT_VALUE;
+                break;
+            case EXPECT_COMMA_OR_END: {
+                const char close = (stack.back() == '{') ? '}' : ']';
+                if(*p == ',') {
+                    p++;
+                    state = (close == '}') ? EXPECT_KEY : EXPECT_VALUE;
+                } else if(*p == close) {
+                    ok = EndContainer(*p++);
+                } else {
+                    return Fail(p, close == '}' ? "expected ',' or '}'" : "expected ',' or ']'");
+                }
+                break;
+            }
+            case EXPECT_DONE:
+                return Fail(p, "unexpected data after the document");
+            }
+            break;
+        }
+        if(!ok) {
+            if(error.empty() && !stopped) return Fail(p, "invalid token");
+            return false;
+        }
+    }
+
+    consumed += size;
+    chunk     = nullptr;
+    return true;
+}
+
+bool
+JsonPushParser::Finish() {
+    if(stopped || !error.empty()) return false;
+
+    /// Top level number has no delimiter to end it
+    if(token == TOKEN_NUMBER) {
+        token = TOKEN_NONE;
+        if(!EmitNumber(StringRef(scratch))) return false;
+    }
+
+    if(token != TOKEN_NONE || state != EXPECT_DONE) {
+        error = "unexpected end of input at offset " + to_string(consumed);
+        return false;
+    }
+    return true;
+}
+
+bool
+JsonPushParser::BeginValue(const char*& p) {
+    switch(*p) {
+    case '{':
+    case '[':
+        if(stack.size() >= max_depth) return Fail(p, "document is nested too deep");
+        stack.push_back(*p);
+        state = (*p == '{') ? EXPECT_KEY_OR_END : EXPECT_VALUE_OR_END;
+        return Emit(*p++ == '{' ? handler.StartObject() : handler.StartArray());
+    case '"':
+        p++;
+        token    = TOKEN_STRING;
+        is_key   = false;
+        buffered = false;
+        return true;
+    case 't': literal = "true";  break;
+    case 'f': literal = "false"; break;
+    case 'n': literal = "null";  break;
+    default:
+        if(*p == '-' || (*p >= '0' && *p <= '9')) {
+            token = TOKEN_NUMBER;
+            scratch.clear();
+            return true;
+        }
+        return Fail(p, "expected value");
+    }
+
+    token           = TOKEN_LITERAL;
+    literal_matched = 0;
+    return true;
+}
+
+bool
+JsonPushParser::ContinueString(const char*& p, const char* end) {
+    /// Fast path: whole string in this chunk, no escapes
+    if(!buffered) {
+        const char* q = scan_plain(p, end);
+        if(q < end && *q == '"') {
+            StringRef value(p, q - p);
+            p = q + 1;
+            token = TOKEN_NONE;
+            return EmitString(value);
+        }
+        scratch.assign(p, q);
+        p         = q;
+        buffered  = true;
+        in_escape = false;
+    }
+
+    while(p < end) {
+        if(in_escape) {
+            if(!ContinueEscape(p)) return false;
+            continue;
+        }
+
+        const char c = *p;
+        if(c == '"') {
+            p++;
+            FlushSurrogate();
+            token = TOKEN_NONE;
+            return EmitString(StringRef(scratch));
+        }
+        if(c == '\\') {
+            p++;
+            in_escape  = true;
+            escape_len = 0;
+            continue;
+        }
+        if(static_cast<unsigned char>(c) < 0x20) return Fail(p, "control character in string");
+
+        FlushSurrogate();
+        const char* q = scan_plain(p, end);
+        scratch.append(p, q);
+        p = q;
+    }
+    return true;
+}
+
+bool
+JsonPushParser::ContinueEscape(const char*& p) {
+    const char c = *p;
+
+    /// Collecting \uXXXX digits
+    if(escape_len > 0) {
+        if(!isxdigit(static_cast<unsigned char>(c))) return Fail(p, "invalid \\u escape");
+        escape[escape_len++ - 1] = c;
+        p++;
+        if(escape_len < 5) return true;
+
+        escape[4] = '\0';
+        uint32_t cp = static_cast<uint32_t>(strtoul(escape, nullptr, 16));
+        in_escape  = false;
+        escape_len = 0;
+
+        if(cp >= 0xD800 && cp <= 0xDBFF) {
+            FlushSurrogate();
+            high_surrogate = cp;
+        } else if(cp >= 0xDC00 && cp <= 0xDFFF && high_surrogate) {
+            AppendCodepoint(0x10000 + ((high_surrogate - 0xD800) << 10) + (cp - 0xDC00));
+            high_surrogate = 0;
+        } else {
+            FlushSurrogate();
+            AppendCodepoint(cp);
+        }
+        return true;
+    }
+
+    char unescaped;
+    switch(c) {
+    case '"':  unescaped = '"';  break;
+    case '\\': unescaped = '\\'; break;
+    case '/':  unescaped = '/';  break;
+    case 'b':  unescaped = '\b'; break;
+    case 'f':  unescaped = '\f'; break;
+    case 'n':  unescaped = '\n'; break;
+    case 'r':  unescaped = '\r'; break;
+    case 't':  unescaped = '\t'; break;
+    case 'u':
+        p++;
+        escape_len = 1;
+        return true;
+    default:
+        return Fail(p, "invalid escape sequence");
+    }
+
+    p++;
+    FlushSurrogate();
+    scratch.push_back(unescaped);
+    in_escape = false;
+    return true;
+}
+
+void
+JsonPushParser::FlushSurrogate() {
+    /// Lone high surrogate can't be encoded, replace it
+    if(high_surrogate) {
+        AppendCodepoint(0xFFFD);
+        high_surrogate = 0;
+    }
+}
+
+void
+JsonPushParser::AppendCodepoint(uint32_t cp) {
+    if(cp >= 0xDC00 && cp <= 0xDFFF) cp = 0xFFFD;
+
+    if(cp < 0x80) {
+        scratch.push_back(static_cast<char>(cp));
+    } else if(cp < 0x800) {
+        scratch.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        scratch.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if(cp < 0x10000) {
+        scratch.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        scratch.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        scratch.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        scratch.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        scratch.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        scratch.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        scratch.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+bool
+JsonPushParser::ContinueNumber(const char*& p, const char* end) {
+    const char* q = p;
+    while(q < end && is_number_char(*q)) q++;
+
+    /// May go on in the next chunk
+    if(q == end) {
+        scratch.append(p, q);
+        p = q;
+        return true;
+    }
+
+    StringRef value;
+    if(scratch.empty()) {
+        value = StringRef(p, q - p);
+    } else {
+        scratch.append(p, q);
+        value = StringRef(scratch);
+    }
+    p     = q;
+    token = TOKEN_NONE;
+    return EmitNumber(value);
+}
+
+bool
+JsonPushParser::ContinueLiteral(const char*& p, const char* end) {
+    while(p < end && literal[literal_matched]) {
+        if(*p != literal[literal_matched]) return Fail(p, "invalid literal");
+        p++;
+        literal_matched++;
+    }
+    if(literal[literal_matched]) return true;
+
+    token = TOKEN_NONE;
+    return EmitLiteral();
+}
+
+bool
+JsonPushParser::EmitString(StringRef value) {
+    if(is_key) {
+        state = EXPECT_COLON;
+        return Emit(handler.Key(value));
+    }
+    ValueDone();
+    return Emit(handler.String(value));
+}
+
+bool
+JsonPushParser::EmitNumber(StringRef value) {
+    /// IDs, dates and counters: validated and decoded in one pass
+    uint64_t magnitude;
+    bool     negative;
+    if(scan_integer(value.data, value.size, &magnitude, &negative)) {
+        if(!negative && magnitude <= static_cast<uint64_t>(INT64_MAX)) {
+            ValueDone();
+            return Emit(handler.Int64(static_cast<int64_t>(magnitude)));
+        }
+        if(!negative) {
+            ValueDone();
+            return Emit(handler.Uint64(magnitude));
+        }
+        if(magnitude <= static_cast<uint64_t>(INT64_MAX) + 1) {
+            ValueDone();
+            return Emit(handler.Int64(static_cast<int64_t>(0 - magnitude)));
+        }
+    }
+
+    /// Fractions, exponents and integers beyond 64 bits
+    if(!valid_number(value)) {
+        error = "invalid number '" + value.str() + "' at offset " + to_string(consumed);
+        return false;
+    }
+    ValueDone();
+
+    /// strtod needs a terminated string, numbers are short
+    char buf[64];
+    if(value.size < sizeof(buf)) {
+        memcpy(buf, value.data, value.size);
+        buf[value.size] = '\0';
+        return Emit(handler.Double(strtod(buf, nullptr)));
+    }
+    return Emit(handler.Double(strtod(value.str().c_str(), nullptr)));
+}
+
+bool
+JsonPushParser::EmitLiteral() {
+    ValueDone();
+    switch(literal[0]) {
+    case 't': return Emit(handler.Bool(true));
+    case 'f': return Emit(handler.Bool(false));
+    default:  return Emit(handler.Null());
+    }
+}
+
+bool
+JsonPushParser::EndContainer(char close) {
+    stack.pop_back();
+    ValueDone();
+    return Emit(close == '}' ? handler.EndObject() : handler.EndArray());
+}
+
+void
+JsonPushParser::ValueDone() {
+    state = stack.empty() ? EXPECT_DONE : EXPECT_COMMA_OR_END;
+}
+
+bool
+JsonPushParser::Emit(bool keep_going) {
+    if(!keep_going) stopped = true;
+    return keep_going;
+}
+
+bool
+JsonPushParser::Fail(const char* p, const string& what) {
+    const size_t offset = consumed + (chunk ? static_cast<size_t>(p - chunk) : 0);
+    error = what + " at offset " + to_string(offset);
+    return false;
+}
+
+bool
+JsonPushParser::isDone() const {
+    return state == EXPECT_DONE && token == TOKEN_NONE;
+}
+
+bool
+JsonPushParser::isStopped() const {
+    return stopped;
+}
+
+bool
+JsonPushParser::hasError() const {
+    return !error.empty();
+}
+
+const string&
+JsonPushParser::getError() const {
+    return error;
+}
+
+size_t
+JsonPushParser::getOffset() const {
+    return consumed;
+}
+
+bool
+JsonPushParser::Parse(const char* data, size_t size, JsonHandler& handler, string* error) {
+    JsonPushParser parser(handler);
+    const bool ok = parser.Feed(data, size) && parser.Finish();
+    if(!ok && error) *error = parser.getError();
+    return ok || parser.isStopped();
+}
+
+}
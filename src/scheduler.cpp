@@ -0,0 +1,264 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "scheduler.hpp"
+#include "vkapi.hpp"
+#include <algorithm>
+
+namespace vk {
+
+RequestScheduler::RequestScheduler(double requests_per_sec)
+    : RequestScheduler(std::make_shared<TokenBucket>(requests_per_sec)) {}
+
+RequestScheduler::RequestScheduler(const std::shared_ptr<RateLimiter>& limiter)
+    : limiter(limiter), vtime(0), seq(0), next_try(steady_clock::now()) {
+    classes[PRIORITY_INTERACTIVE].weight = 8;
+    classes[PRIORITY_NORMAL].weight      = 4;
+    classes[PRIORITY_BULK].weight        = 1;
+}
+
+void
+RequestScheduler::Acquire(const RequestContext& ctx) {
+    std::unique_lock<std::mutex> lock(mtx);
+
+    Class& cls = classes[ctx.getPriority()];
+    if(cls.limit && cls.queued >= cls.limit) Admit(lock, cls, ctx);
+
+    Ticket ticket;
+    ticket.seq = seq++;
+    Enqueue(cls, ctx.getTenant(), &ticket);
+    cls.peak = std::max(cls.peak, cls.queued);
+
+    for(;;) {
+        if(ticket.dropped) {
+            lock.unlock();
+            throw OverloadedException("request dropped from full rate limit queue by newer ones");
+        }
+
+        Dispatch();
+        if(ticket.granted) return;
+
+        if(ctx.isCancelled() || ctx.isExpired()) {
+            Remove(cls, ctx.getTenant(), &ticket);
+            lock.unlock();
+            if(ctx.isCancelled()) throw CancelledException("request cancelled while waiting for rate limit");
+            throw DeadlineException("request deadline exceeded while waiting for rate limit");
+        }
+
+        /// Wake up for the next permit, on grant by another thread, or to notice cancellation
+        steady_clock::time_point wake = std::min(next_try, steady_clock::now() + VKAPI_CANCEL_POLL_INTERVAL);
+        if(ctx.hasDeadline()) wake = std::min(wake, ctx.getDeadline());
+        cv.wait_until(lock, wake);
+    }
+}
+
+bool
+RequestScheduler::TryAcquire() {
+    std::lock_guard<std::mutex> lock(mtx);
+
+    /// Never overtake callers waiting in the queue
+    for(const Class& cls : classes) {
+        if(cls.queued) return false;
+    }
+    milliseconds wait(0);
+    return limiter->TryAcquire(1.0, &wait);
+}
+
+void
+RequestScheduler::Admit(std::unique_lock<std::mutex>& lock, Class& cls, const RequestContext& ctx) {
+    if(cls.policy == ADMIT_DROP_OLDEST) {
+        DropOldest(cls);
+        return;
+    }
+
+    if(cls.policy == ADMIT_BLOCK) {
+        const steady_clock::time_point until = steady_clock::now() + cls.block_timeout;
+        while(cls.limit && cls.queued >= cls.limit) {
+            if(ctx.isCancelled()) throw CancelledException("request cancelled while waiting for rate limit queue");
+            if(ctx.isExpired())   throw DeadlineException("request deadline exceeded while waiting for rate limit queue");
+
+            steady_clock::time_point now = steady_clock::now();
+            if(now >= until) break;
+
+            /// Place frees up on grant or removal, both notify
+            steady_clock::time_point wake = std::min(until, now + VKAPI_CANCEL_POLL_INTERVAL);
+            if(ctx.hasDeadline()) wake = std::min(wake, ctx.getDeadline());
+            cv.wait_until(lock, wake);
+        }
+        if(!cls.limit || cls.queued < cls.limit) return;
+    }
+
+    cls.rejected++;
+    lock.unlock();
+    throw OverloadedException("rate limit queue is full");
+}
+
+void
+RequestScheduler::DropOldest(Class& cls) {
+    auto oldest = cls.tenants.end();
+    for(auto it = cls.tenants.begin(); it != cls.tenants.end(); ++it) {
+        if(oldest == cls.tenants.end() || it->second.queue.front()->seq < oldest->second.queue.front()->seq) {
+            oldest = it;
+        }
+    }
+    if(oldest == cls.tenants.end()) return;
+
+    oldest->second.queue.front()->dropped = true;
+    oldest->second.queue.pop_front();
+    if(oldest->second.queue.empty()) cls.tenants.erase(oldest);
+    cls.queued--;
+    cls.dropped++;
+
+    /// Let the dropped caller know
+    cv.notify_all();
+}
+
+void
+RequestScheduler::Enqueue(Class& cls, const string& tenant, Ticket* ticket) {
+    /// Idle class or tenant doesn't save up credit while it had nothing to send
+    if(cls.queued == 0) cls.pass = std::max(cls.pass, vtime);
+
+    Tenant& t = cls.tenants[tenant];
+    if(t.queue.empty()) t.pass = std::max(t.pass, cls.vtime);
+
+    t.queue.push_back(ticket);
+    cls.queued++;
+}
+
+void
+RequestScheduler::Remove(Class& cls, const string& tenant, Ticket* ticket) {
+    auto it = cls.tenants.find(tenant);
+    if(it == cls.tenants.end()) return;
+
+    std::deque<Ticket*>& queue = it->second.queue;
+    auto pos = std::find(queue.begin(), queue.end(), ticket);
+    if(pos == queue.end()) return;
+
+    queue.erase(pos);
+    cls.queued--;
+    if(queue.empty()) cls.tenants.erase(it);
+
+    /// Place is free for a blocked caller
+    cv.notify_all();
+}
+
+void
+RequestScheduler::Dispatch() {
+    for(;;) {
+        bool waiting = false;
+        for(const Class& cls : classes) waiting |= cls.queued > 0;
+        if(!waiting) return;
+
+        steady_clock::time_point now = steady_clock::now();
+        if(now < next_try) return;
+
+        milliseconds wait(0);
+        if(!limiter->TryAcquire(1.0, &wait)) {
+            next_try = now + std::max(wait, milliseconds(1));
+            return;
+        }
+        Grant();
+    }
+}
+
+void
+RequestScheduler::Grant() {
+    /// Class with the least pass, then its tenant with the least pass
+    Class* cls = nullptr;
+    for(Class& c : classes) {
+        if(c.queued && (!cls || c.pass < cls->pass)) cls = &c;
+    }
+
+    auto tenant = cls->tenants.begin();
+    for(auto it = cls->tenants.begin(); it != cls->tenants.end(); ++it) {
+        if(it->second.pass < tenant->second.pass) tenant = it;
+    }
+
+    Ticket* ticket = tenant->second.queue.front();
+    tenant->second.queue.pop_front();
+    ticket->granted = true;
+
+    vtime       = cls->pass;
+    cls->pass  += 1.0 / cls->weight;
+    cls->vtime  = tenant->second.pass;
+    tenant->second.pass += 1.0 / TenantWeight(tenant->first);
+
+    cls->queued--;
+    cls->granted++;
+    if(tenant->second.queue.empty()) cls->tenants.erase(tenant);
+
+    cv.notify_all();
+}
+
+double
+RequestScheduler::TenantWeight(const string& tenant) const {
+    auto it = tenant_weights.find(tenant);
+    return it == tenant_weights.end() ? 1.0 : it->second;
+}
+
+void
+RequestScheduler::SetLimiter(const std::shared_ptr<RateLimiter>& limiter) {
+    std::lock_guard<std::mutex> lock(mtx);
+    this->limiter = limiter;
+}
+
+void
+RequestScheduler::SetWeight(RequestPriority priority, double weight) {
+    std::lock_guard<std::mutex> lock(mtx);
+    classes[priority].weight = weight;
+}
+
+void
+RequestScheduler::SetTenantWeight(const string& tenant, double weight) {
+    std::lock_guard<std::mutex> lock(mtx);
+    tenant_weights[tenant] = weight;
+}
+
+void
+RequestScheduler::SetQueueLimit(RequestPriority priority, size_t limit, AdmissionPolicy policy,
+                                milliseconds block_timeout) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Class& cls        = classes[priority];
+    cls.limit         = limit;
+    cls.policy        = policy;
+    cls.block_timeout = block_timeout;
+    cv.notify_all();
+}
+
+std::shared_ptr<RateLimiter>
+RequestScheduler::getLimiter() const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return limiter;
+}
+
+size_t
+RequestScheduler::getQueued(RequestPriority priority) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return classes[priority].queued;
+}
+
+size_t
+RequestScheduler::getPeakQueued(RequestPriority priority) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return classes[priority].peak;
+}
+
+uint64_t
+RequestScheduler::getGranted(RequestPriority priority) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return classes[priority].granted;
+}
+
+uint64_t
+RequestScheduler::getRejected(RequestPriority priority) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return classes[priority].rejected;
+}
+
+uint64_t
+RequestScheduler::getDropped(RequestPriority priority) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    return classes[priority].dropped;
+}
+
+}
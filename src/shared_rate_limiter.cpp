@@ -0,0 +1,125 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "shared_rate_limiter.hpp"
+#include "vkapi.hpp"
+#include "log.hpp"
+
+#include <sstream>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace vk {
+
+#define SHARED_BUCKET_MAGIC  0x4c52564b62696c01ULL   ///< "libVKRL" + layout version 1
+
+/// Arrival time further ahead than tolerance + this is garbage: previous boot, clock jump
+#define SHARED_BUCKET_MAX_SKEW_NS 1000000000LL
+
+static uint64_t fnv1a(const string& str) {
+    uint64_t hash = 14695981039346656037ULL;
+    for(unsigned char c : str) {
+        hash ^= c;
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static int64_t monotonic_ns() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000000000LL + ts.tv_nsec;
+}
+
+SharedTokenBucket::SharedTokenBucket(const string& access_token, double rate, double burst,
+                                     const string& directory)
+    : fd(-1), state(nullptr) {
+    rate         = std::max(rate, 0.001);
+    interval_ns  = static_cast<int64_t>(1e9 / rate);
+    tolerance_ns = static_cast<int64_t>(std::max(burst, 1.0) * interval_ns);
+
+    std::stringstream ss;
+    ss << directory << "/libvk-ratelimit-" << std::hex << fnv1a(access_token);
+    path = ss.str();
+
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(fd < 0) {
+        throw libVKException(errno, "can't open shared rate limiter " + path);
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) < 0 || (st.st_size < static_cast<off_t>(sizeof(State)) && ftruncate(fd, sizeof(State)) < 0)) {
+        int err = errno;
+        close(fd);
+        throw libVKException(err, "can't size shared rate limiter " + path);
+    }
+
+    void* mem = mmap(nullptr, sizeof(State), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if(mem == MAP_FAILED) {
+        int err = errno;
+        close(fd);
+        throw libVKException(err, "can't map shared rate limiter " + path);
+    }
+    state = static_cast<State*>(mem);
+
+    uint64_t magic = 0;
+    if(!state->magic.compare_exchange_strong(magic, SHARED_BUCKET_MAGIC) && magic != SHARED_BUCKET_MAGIC) {
+        munmap(state, sizeof(State));
+        close(fd);
+        throw libVKException("incompatible shared rate limiter " + path);
+    }
+
+    LOG2() << "shared rate limiter at " << path;
+}
+
+SharedTokenBucket::~SharedTokenBucket() {
+    /// File stays for other processes, it's tiny and reused on next start
+    munmap(state, sizeof(State));
+    close(fd);
+}
+
+bool
+SharedTokenBucket::TryAcquire(double cost, milliseconds* wait) {
+    const int64_t increment = static_cast<int64_t>(cost * interval_ns);
+
+    for(;;) {
+        const int64_t now = monotonic_ns();
+        int64_t tat = state->tat_ns.load();
+
+        if(tat - now > tolerance_ns + increment + SHARED_BUCKET_MAX_SKEW_NS) {
+            WARNING() << "shared rate limiter state is out of range, resetting";
+            state->tat_ns.compare_exchange_strong(tat, now);
+            continue;
+        }
+
+        const int64_t new_tat  = std::max(tat, now) + increment;
+        const int64_t allow_at = new_tat - tolerance_ns;
+
+        if(allow_at > now) {
+            if(wait) *wait = milliseconds((allow_at - now + 999999) / 1000000);
+            return false;
+        }
+
+        if(state->tat_ns.compare_exchange_weak(tat, new_tat)) {
+            state->granted++;
+            return true;
+        }
+    }
+}
+
+const string&
+SharedTokenBucket::getPath() const {
+    return path;
+}
+
+uint64_t
+SharedTokenBucket::getGranted() const {
+    return state->granted.load();
+}
+
+}
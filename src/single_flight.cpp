@@ -0,0 +1,61 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "single_flight.hpp"
+#include "vkapi.hpp"
+#include <algorithm>
+
+namespace vk {
+
+std::shared_ptr<SingleFlight::Call>
+SingleFlight::Join(const string& key, bool* leader) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = calls.find(key);
+    if(it != calls.end()) {
+        *leader = false;
+        deduplicated++;
+        return it->second;
+    }
+
+    std::shared_ptr<Call> call = std::make_shared<Call>();
+    calls[key] = call;
+    *leader = true;
+    return call;
+}
+
+void
+SingleFlight::Finish(const string& key, const std::shared_ptr<Call>& call) {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = calls.find(key);
+    if(it != calls.end() && it->second == call) {
+        calls.erase(it);
+    }
+}
+
+void
+SingleFlight::Complete(const string& key, const std::shared_ptr<Call>& call, const VKValue& result) {
+    Finish(key, call);
+    call->promise.set_value(result);
+}
+
+void
+SingleFlight::Fail(const string& key, const std::shared_ptr<Call>& call, std::exception_ptr error) {
+    Finish(key, call);
+    call->promise.set_exception(error);
+}
+
+VKValue
+SingleFlight::Wait(const std::shared_ptr<Call>& call, const RequestContext& ctx) {
+    while(call->future.wait_for(std::min(VKAPI_CANCEL_POLL_INTERVAL, ctx.getRemaining())) != std::future_status::ready) {
+        if(ctx.isCancelled()) throw CancelledException("request cancelled");
+        if(ctx.isExpired())   throw DeadlineException("request deadline exceeded");
+    }
+    return call->future.get();
+}
+
+uint64_t
+SingleFlight::getDeduplicated() const {
+    return deduplicated;
+}
+
+}
@@ -0,0 +1,153 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "timeout.hpp"
+#include <algorithm>
+
+namespace vk {
+
+/* ##### LatencyTracker ##### */
+
+LatencyTracker::LatencyTracker(size_t window)
+    : window(std::max<size_t>(window, 1)) {}
+
+void
+LatencyTracker::Record(const string& method, milliseconds latency) {
+    std::lock_guard<std::mutex> lock(mtx);
+    Samples& samples = methods[method];
+    if(samples.ring.size() < window) {
+        samples.ring.push_back(latency.count());
+    } else {
+        samples.ring[samples.next] = latency.count();
+        samples.next = (samples.next + 1) % window;
+    }
+}
+
+milliseconds
+LatencyTracker::Percentile(const string& method, double p, size_t min_samples) const {
+    vector<milliseconds::rep> sorted;
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        auto it = methods.find(method);
+        if(it == methods.end() || it->second.ring.size() < std::max<size_t>(min_samples, 1)) {
+            return milliseconds(0);
+        }
+        sorted = it->second.ring;
+    }
+
+    size_t idx = static_cast<size_t>(std::min(std::max(p, 0.0), 1.0) * (sorted.size() - 1));
+    std::nth_element(sorted.begin(), sorted.begin() + idx, sorted.end());
+    return milliseconds(sorted[idx]);
+}
+
+size_t
+LatencyTracker::getSamples(const string& method) const {
+    std::lock_guard<std::mutex> lock(mtx);
+    auto it = methods.find(method);
+    return it == methods.end() ? 0 : it->second.ring.size();
+}
+
+/* ##### TimeoutPolicy ##### */
+
+TimeoutPolicy::TimeoutPolicy()
+    : adaptive(true),
+      min_timeout(1000),
+      max_timeout(5000),
+      percentile(0.99),
+      multiplier(3.0),
+      min_samples(20),
+      hedging(false),
+      hedge_percentile(0.95),
+      tracker(std::make_shared<LatencyTracker>()) {}
+
+milliseconds
+TimeoutPolicy::Timeout(const string& method) const {
+    if(!adaptive || !tracker) return max_timeout;
+
+    milliseconds observed = tracker->Percentile(method, percentile, min_samples);
+    if(observed.count() == 0) return max_timeout;
+
+    milliseconds timeout(static_cast<milliseconds::rep>(observed.count() * multiplier));
+    return std::min(std::max(timeout, min_timeout), max_timeout);
+}
+
+milliseconds
+TimeoutPolicy::HedgeDelay(const string& method) const {
+    if(!hedging || !tracker || !IsIdempotent(method)) return milliseconds(0);
+    return std::max(tracker->Percentile(method, hedge_percentile, min_samples), milliseconds(0));
+}
+
+bool
+TimeoutPolicy::IsIdempotent(const string& method) const {
+    if(idempotent_methods.find(method) != idempotent_methods.end()) return true;
+
+    /// Read-only VK methods are named section.getSomething, section.search, section.isSomething
+    size_t dot = method.find('.');
+    if(dot == string::npos) return false;
+    const string name = method.substr(dot + 1);
+    return name.compare(0, 3, "get") == 0
+        || name.compare(0, 6, "search") == 0
+        || name.compare(0, 2, "is") == 0
+        || name.compare(0, 5, "check") == 0
+        || name.compare(0, 7, "resolve") == 0;
+}
+
+void
+TimeoutPolicy::Record(const string& method, milliseconds latency) {
+    if(tracker) tracker->Record(method, latency);
+}
+
+void
+TimeoutPolicy::SetAdaptive(bool adaptive) {
+    this->adaptive = adaptive;
+}
+
+void
+TimeoutPolicy::SetBounds(milliseconds min_timeout, milliseconds max_timeout) {
+    this->min_timeout = min_timeout;
+    this->max_timeout = max_timeout;
+}
+
+void
+TimeoutPolicy::SetPercentile(double percentile, double multiplier) {
+    this->percentile = percentile;
+    this->multiplier = multiplier;
+}
+
+void
+TimeoutPolicy::SetMinSamples(size_t min_samples) {
+    this->min_samples = min_samples;
+}
+
+void
+TimeoutPolicy::SetHedging(bool hedging, double hedge_percentile) {
+    this->hedging          = hedging;
+    this->hedge_percentile = hedge_percentile;
+}
+
+void
+TimeoutPolicy::SetIdempotentMethods(const std::set<string>& methods) {
+    this->idempotent_methods = methods;
+}
+
+void
+TimeoutPolicy::SetTracker(const std::shared_ptr<LatencyTracker>& tracker) {
+    this->tracker = tracker;
+}
+
+bool
+TimeoutPolicy::isAdaptive() const {
+    return adaptive;
+}
+
+bool
+TimeoutPolicy::isHedging() const {
+    return hedging;
+}
+
+const std::shared_ptr<LatencyTracker>&
+TimeoutPolicy::getTracker() const {
+    return tracker;
+}
+
+}
@@ -7,12 +7,28 @@
 #include <string>
 #include <iostream>
 #include <string.h>
+#include <stdlib.h>
 #include <thread>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <netdb.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <arpa/inet.h>
+
+/// TLS session export and import appeared in libcurl 8.12.0
+#if LIBCURL_VERSION_NUM >= 0x080c00
+#define VKAPI_HAS_SSLS
+#endif
 
 namespace vk {
 
 using std::chrono::system_clock;
 using std::chrono::duration_cast;
+using std::chrono::steady_clock;
 
 #define VKAPI_INITIALIZER_LIST users(this), auth(this), wall(this), photos(this),                                   \
                                friends(this), widgets(this), storage(this), status(this),                           \
@@ -27,8 +43,26 @@ using std::chrono::duration_cast;
 VKAPI::VKAPI() : VKAPI_INITIALIZER_LIST {
     this->app_id = "";
     this->app_secret = "";
-    this->curl_handle = nullptr;
+    this->api_url    = VKAPI_URL;
+    this->auth_url   = VKAPI_AUTH_URL;
+    this->curl_handle     = nullptr;
+    this->curl_multi      = nullptr;
+    this->hedge_handle    = nullptr;
+    this->ssl_verify_peer = true;
+    this->resolve_list    = nullptr;
+    this->tls_share       = nullptr;
+    this->sax_handler     = nullptr;
+    this->lazy_view       = false;
+    this->item_stream     = nullptr;
+    this->pool_connections = 1;
+    this->health_interval  = milliseconds(0);
+    this->health_stop      = false;
+    this->health_probes    = 0;
+    this->reconnects       = 0;
+    this->last_transfer    = steady_clock::now();
+    this->dns_refresh     = milliseconds(60000);
     this->curl_errno = CURLE_OK;
+    this->vk_errno   = RESULT_SUCCESS;
     this->def_access_token = "";
     this->def_api_version  = "";
     this->def_lang         = "ru";
@@ -41,6 +75,12 @@ VKAPI::VKAPI() : VKAPI_INITIALIZER_LIST {
         throw CurlException("curl_easy_init() failed");
     }
 
+    curl_multi = curl_multi_init();
+    if(!curl_multi) {
+        curl_easy_cleanup(curl_handle);
+        throw CurlException("curl_multi_init() failed");
+    }
+
     LOG3() << "initialized new curl handle";
 
     curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, VKAPI::CurlWriteDataCallback);
@@ -49,9 +89,219 @@ VKAPI::VKAPI() : VKAPI_INITIALIZER_LIST {
     LOG3() << "curl writefunction is JSON writer now";
 }
 
-VKAPI::VKAPI(const string& app_id, const string& app_secret) : VKAPI() {
+VKAPI::VKAPI(const string& app_id, const string& app_secret, bool warmup) : VKAPI() {
     this->app_id     = app_id;
     this->app_secret = app_secret;
+    if(warmup) Warmup();
+}
+
+VKAPI::~VKAPI() {
+    StopHealthCheck();
+    if(!tls_session_file.empty()) SaveTLSSessions();
+
+    if(hedge_handle) curl_easy_cleanup(hedge_handle);
+    curl_easy_cleanup(curl_handle);
+    curl_multi_cleanup(curl_multi);
+    curl_slist_free_all(resolve_list);
+    if(tls_share) curl_share_cleanup(tls_share);
+}
+
+/// Numeric addresses of host in CURLOPT_RESOLVE notation, IPv6 in brackets
+static StrArray resolve_host(const string& host, const string& port) {
+    StrArray addresses;
+
+    addrinfo hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family   = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    addrinfo* result = nullptr;
+    int err = getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if(err != 0) {
+        WARNING() << "can't resolve " << host << ": " << gai_strerror(err);
+        return addresses;
+    }
+
+    for(addrinfo* ai = result; ai; ai = ai->ai_next) {
+        char buf[INET6_ADDRSTRLEN];
+        const void* addr = (ai->ai_family == AF_INET6)
+                         ? static_cast<const void*>(&reinterpret_cast<sockaddr_in6*>(ai->ai_addr)->sin6_addr)
+                         : static_cast<const void*>(&reinterpret_cast<sockaddr_in*>(ai->ai_addr)->sin_addr);
+        if(!inet_ntop(ai->ai_family, addr, buf, sizeof(buf))) continue;
+
+        string address = (ai->ai_family == AF_INET6) ? "[" + string(buf) + "]" : string(buf);
+        if(std::find(addresses.begin(), addresses.end(), address) == addresses.end()) {
+            addresses.push_back(address);
+        }
+    }
+    freeaddrinfo(result);
+    return addresses;
+}
+
+bool
+VKAPI::PinHosts() {
+    resolved_at = steady_clock::now();
+
+    /// getaddrinfo() may block for seconds, requests and the health checker go on meanwhile
+    curl_slist* list = nullptr;
+    for(const string& url : {api_url, auth_url}) {
+        string host, port;
+        url_endpoint(url, &host, &port);
+
+        StrArray addresses = resolve_host(host, port);
+        if(addresses.empty()) continue;
+
+        string entry = host + ":" + port + ":" + addresses[0];
+        for(size_t i = 1; i < addresses.size(); i++) entry += "," + addresses[i];
+        LOG3() << "pinned " << entry;
+
+        /// Replace what an earlier pin left in curl DNS cache
+        list = curl_slist_append(list, ("-" + host + ":" + port).c_str());
+        list = curl_slist_append(list, entry.c_str());
+    }
+
+    /// Keep the old pins if DNS is down, stale addresses beat none
+    if(!list) return false;
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    curl_slist_free_all(resolve_list);
+    resolve_list = list;
+    return true;
+}
+
+void
+VKAPI::RefreshPinnedHosts() {
+    if(!resolve_list || dns_refresh.count() == 0) return;
+    if(steady_clock::now() - resolved_at < dns_refresh) return;
+    PinHosts();
+}
+
+size_t
+VKAPI::Warmup(size_t connections) {
+    PinHosts();
+
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    pool_connections = std::max<size_t>(connections, 1);
+
+    size_t opened = OpenConnections(connections, true, milliseconds(5000));
+    LOG2() << "warmup opened " << opened << " connections";
+    return opened;
+}
+
+size_t
+VKAPI::OpenConnections(size_t connections, bool auth_host, milliseconds timeout) {
+    /// Cheap requests VK answers without a token, connections stay in the multi handle cache
+    vector<CURL*> handles;
+    string        discard;
+    const size_t  total = connections + (auth_host ? 1 : 0);
+    for(size_t i = 0; i < total; i++) {
+        CURL* handle = curl_easy_init();
+        if(!handle) break;
+
+        const bool auth = (i == connections);
+        SetupTransfer(handle, auth ? auth_url : api_url + "utils.getServerTime", &discard, timeout);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, VKAPI::CurlDiscardCallback);
+        if(auth) curl_easy_setopt(handle, CURLOPT_NOBODY, 1L);
+        curl_multi_add_handle(curl_multi, handle);
+        handles.push_back(handle);
+    }
+    curl_multi_setopt(curl_multi, CURLMOPT_MAXCONNECTS, static_cast<long>(connections + 2));
+
+    size_t opened = 0;
+    int    running = 1;
+    while(running) {
+        curl_multi_perform(curl_multi, &running);
+
+        CURLMsg* msg;
+        int      msgs_left;
+        while((msg = curl_multi_info_read(curl_multi, &msgs_left))) {
+            if(msg->msg != CURLMSG_DONE) continue;
+            if(msg->data.result == CURLE_OK) {
+                opened++;
+            } else {
+                WARNING() << "connection to VK failed: " << curl_easy_strerror(msg->data.result);
+            }
+        }
+        if(running) curl_multi_wait(curl_multi, nullptr, 0, 100, nullptr);
+    }
+
+    for(CURL* handle : handles) {
+        curl_multi_remove_handle(curl_multi, handle);
+        curl_easy_cleanup(handle);
+    }
+    return opened;
+}
+
+/* ##### Connection health ##### */
+
+void
+VKAPI::SetHealthCheck(milliseconds interval) {
+    StopHealthCheck();
+    if(interval.count() == 0) return;
+
+    health_interval = interval;
+    health_stop     = false;
+    health_thread   = std::thread(&VKAPI::HealthLoop, this);
+}
+
+void
+VKAPI::StopHealthCheck() {
+    if(!health_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(health_mtx);
+        health_stop = true;
+    }
+    health_cv.notify_all();
+    health_thread.join();
+}
+
+void
+VKAPI::HealthLoop() {
+    std::unique_lock<std::mutex> lock(health_mtx);
+    while(!health_stop) {
+        health_cv.wait_for(lock, health_interval);
+        if(health_stop) break;
+
+        lock.unlock();
+        CheckConnections();
+        lock.lock();
+    }
+}
+
+void
+VKAPI::CheckConnections() {
+    /// Busy client has nothing idle to check, its requests find dead connections themselves
+    std::unique_lock<std::mutex> lock(curl_mtx, std::try_to_lock);
+    if(!lock.owns_lock()) return;
+    if(steady_clock::now() - last_transfer < health_interval) return;
+
+    health_probes++;
+    size_t alive = OpenConnections(pool_connections, false, VKAPI_PROBE_TIMEOUT);
+    last_transfer = steady_clock::now();
+    if(alive == pool_connections) return;
+
+    /// Fresh multi handle drops every pooled connection, the dead ones included
+    WARNING() << "idle connection probe failed, reconnecting to " << url_host(api_url);
+    CURLM* fresh = curl_multi_init();
+    if(!fresh) {
+        WARNING() << "curl_multi_init() failed, keeping old connections";
+        return;
+    }
+    curl_multi_cleanup(curl_multi);
+    curl_multi = fresh;
+    reconnects++;
+
+    alive = OpenConnections(pool_connections, false, VKAPI_PROBE_TIMEOUT);
+    LOG2() << "reconnected " << alive << " of " << pool_connections << " connections";
+}
+
+uint64_t
+VKAPI::getHealthProbes() const {
+    return health_probes;
+}
+
+uint64_t
+VKAPI::getReconnects() const {
+    return reconnects;
 }
 
 API_RETURN_VALUE
@@ -64,7 +314,18 @@ VKAPI::Authorize(const string& login, const string& passwd, string* access_token
         {"password",      passwd}
     };
 
-    CustomRequest(VKAPI_AUTH_URL, "token", args);
+    /// Only transport errors are worth retrying here, asking for a token again is harmless
+    retry_policy.OnRequest();
+    for(size_t attempt = 0;; attempt++) {
+        try {
+            CustomRequest(auth_url, "token", args, context);
+            break;
+        } catch(CurlException&) {
+            CheckContext(context);
+            if(!retry_policy.ShouldRetry(curl_errno, attempt, true)) throw;
+            RetryBackoff("token", attempt, milliseconds(0), context);
+        }
+    }
 
     if(!json.isMember("access_token") || json.isMember("error")) {
         string error_msg;
@@ -90,22 +351,155 @@ VKAPI::Authorize(const string& login, const string& passwd, string* access_token
 
 API_RETURN_VALUE
 VKAPI::Request(const string& method, Args& arguments) {
-    /// Make sure we won't exceed requests limit
-    if(request_counter++ >= max_requests_per_second) {
-        milliseconds current_time = current_time();
-        milliseconds diff         = current_time - last_time;
-        milliseconds request_time = milliseconds(1000 / max_requests_per_second);
-        if(diff < request_time) {
-            std::this_thread::sleep_for(request_time);
-            request_counter--;
+    return Request(method, arguments, context);
+}
+
+void
+VKAPI::Request(const string& method, Args& arguments, JsonHandler& handler) {
+    Request(method, arguments, handler, context);
+}
+
+void
+VKAPI::Request(const string& method, Args& arguments, JsonHandler& handler, const RequestContext& ctx) {
+    AppendDefaults(arguments);
+
+    /// No DOM to share, so no single flight either
+    sax_handler = &handler;
+    try {
+        Execute(method, arguments, ctx);
+    } catch(...) {
+        sax_handler = nullptr;
+        throw;
+    }
+    sax_handler = nullptr;
+}
+
+const JsonDocument&
+VKAPI::RequestView(const string& method, Args& arguments) {
+    return RequestView(method, arguments, context);
+}
+
+const JsonDocument&
+VKAPI::RequestView(const string& method, Args& arguments, const RequestContext& ctx) {
+    AppendDefaults(arguments);
+
+    /// The view points into buffer, so it can't be shared by single flight
+    lazy_view = true;
+    try {
+        Execute(method, arguments, ctx);
+    } catch(...) {
+        lazy_view = false;
+        throw;
+    }
+    lazy_view = false;
+    return view;
+}
+
+size_t
+VKAPI::RequestItems(const string& method, Args& arguments, const ItemStream::Callback& callback) {
+    return RequestItems(method, arguments, callback, context);
+}
+
+size_t
+VKAPI::RequestItems(const string& method, Args& arguments, const ItemStream::Callback& callback, const RequestContext& ctx) {
+    AppendDefaults(arguments);
+
+    ItemStream stream(callback);
+    item_stream = &stream;
+    try {
+        Execute(method, arguments, ctx);
+    } catch(...) {
+        item_stream = nullptr;
+        throw;
+    }
+    item_stream = nullptr;
+    return stream.getItems();
+}
+
+size_t
+VKAPI::RequestColumns(const string& method, Args& arguments, ColumnSet& columns) {
+    return RequestColumns(method, arguments, columns, context);
+}
+
+size_t
+VKAPI::RequestColumns(const string& method, Args& arguments, ColumnSet& columns, const RequestContext& ctx) {
+    /// Rows of a response that failed midway are dropped, columns stay of equal length
+    const size_t rows = columns.getRows();
+    try {
+        return RequestItems(method, arguments, columns.Collector(), ctx);
+    } catch(...) {
+        columns.Truncate(rows);
+        throw;
+    }
+}
+
+VKValue
+VKAPI::RequestPointers(const string& method, Args& arguments, const vector<string>& pointers) {
+    return RequestPointers(method, arguments, pointers, context);
+}
+
+VKValue
+VKAPI::RequestPointers(const string& method, Args& arguments, const vector<string>& pointers, const RequestContext& ctx) {
+    /// Parse before the request so a typo doesn't cost a round trip
+    vector<JsonPointer> parsed;
+    for(const string& pointer : pointers) parsed.emplace_back(pointer);
+
+    const JsonView root = RequestView(method, arguments, ctx).getRoot();
+
+    VKValue result(Json::objectValue);
+    vector<JsonView> found;
+    for(const JsonPointer& pointer : parsed) {
+        VKValue& value = result[pointer.getPointer()];
+        if(!pointer.isWildcard()) {
+            value = pointer.Get(root).toValue();
+            continue;
+        }
+
+        found.clear();
+        pointer.Select(root, found);
+        value = VKValue(Json::arrayValue);
+        for(const JsonView& match : found) value.append(match.toValue());
+    }
+    return result;
+}
+
+const Response&
+VKAPI::RequestResponse(const string& method, Args& arguments) {
+    return RequestResponse(method, arguments, context);
+}
+
+const Response&
+VKAPI::RequestResponse(const string& method, Args& arguments, const RequestContext& ctx) {
+    response.Clear();
+
+    switch(response.parsed) {
+    case JSON_BACKEND_VIEW: {
+        RequestView(method, arguments, ctx);
+
+        /// Take the body over, later requests refill buffer. Swapping keeps the storage
+        /// of a long string, so the index is only rebuilt for a short one.
+        const char* body = buffer.data();
+        response.text.swap(buffer);
+        if(response.text.data() == body) {
+            std::swap(response.view, view);
         } else {
-            uint32_t missed = diff / request_time;
-            if(missed < request_counter) request_counter -= missed;
-            else                         request_counter  = 0;
+            response.view.Reset(response.text.data(), response.text.size());
         }
-        last_time = current_time();
+        view = JsonDocument();
+        break;
     }
+    case JSON_BACKEND_ARENA:
+        Request(method, arguments, response.arena, ctx);
+        break;
+    default:
+        response.json = Request(method, arguments, ctx);
+        break;
+    }
+    return response;
+}
 
+void
+VKAPI::AppendDefaults(Args& arguments) {
     /// Append default access_token
     if(arguments.find("access_token") == arguments.end()) {
         if(def_access_token == "") {
@@ -132,34 +526,600 @@ VKAPI::Request(const string& method, Args& arguments) {
             arguments["lang"] = def_lang;
         }
     }
+}
 
-    CustomRequest(VKAPI_URL, method, arguments);
-    HandleError(json);
+API_RETURN_VALUE
+VKAPI::Request(const string& method, Args& arguments, const RequestContext& ctx) {
+    AppendDefaults(arguments);
 
-    return json;
+    /// Identical read requests in flight share one answer
+    if(single_flight && timeout_policy.IsIdempotent(method)) {
+        const string key = api_url + method + "?" + to_string(arguments);
+
+        for(;;) {
+            bool leader = false;
+            std::shared_ptr<SingleFlight::Call> call = single_flight->Join(key, &leader);
+
+            if(leader) {
+                try {
+                    Execute(method, arguments, ctx);
+                } catch(...) {
+                    single_flight->Fail(key, call, std::current_exception());
+                    throw;
+                }
+                single_flight->Complete(key, call, json);
+                return json;
+            }
+
+            try {
+                json = single_flight->Wait(call, ctx);
+                return json;
+            } catch(CancelledException&) {
+                /// Leader was cancelled, not us: try again, probably as a leader
+                if(ctx.isCancelled()) throw;
+            } catch(DeadlineException&) {
+                if(ctx.isExpired()) throw;
+            }
+        }
+    }
+
+    return Execute(method, arguments, ctx);
+}
+
+API_RETURN_VALUE
+VKAPI::Execute(const string& method, const Args& arguments, const RequestContext& ctx) {
+    const string host       = url_host(api_url);
+    const bool   idempotent = timeout_policy.IsIdempotent(method);
+
+    retry_policy.OnRequest();
+    for(size_t attempt = 0;; attempt++) {
+        CheckContext(ctx);
+
+        /// Fail fast without spending a rate limit slot
+        CircuitBreakerPermit permit;
+        if(circuit_breakers && !circuit_breakers->Allow(host, method, permit)) {
+            throw CircuitOpenException("circuit breaker is open for " + method);
+        }
+
+        /// The concurrency slot is held for the whole attempt, rate limit wait included, so the
+        /// controller sees requests queueing on the rate limit as growing latency.
+        /// Nothing is sent if waiting for it throws, so a half-open trial taken above is given back.
+        try {
+            if(concurrency) concurrency->Acquire(host, ctx);
+        } catch(...) {
+            if(circuit_breakers) circuit_breakers->Release(host, method, permit);
+            throw;
+        }
+        const steady_clock::time_point slot_start = steady_clock::now();
+
+        steady_clock::time_point attempt_start;
+        try {
+            WaitRateLimit(ctx);
+            /// Charged only right before sending, so a cancelled or shed attempt costs nothing of method caps
+            if(quota) quota->Charge(method, arguments);
+            attempt_start = steady_clock::now();
+            CustomRequest(api_url, method, arguments, ctx);
+            HandleError(json);
+            ReportOutcome(host, method, slot_start, attempt_start, RESULT_SUCCESS);
+            return json;
+        } catch(CurlException&) {
+            ReportOutcome(host, method, slot_start, attempt_start, RESULT_ERROR, true);
+            CheckContext(ctx);
+            if(!retry_policy.ShouldRetry(curl_errno, attempt, idempotent)) throw;
+            RetryBackoff(method, attempt, milliseconds(0), ctx);
+        } catch(VKException&) {
+            ReportOutcome(host, method, slot_start, attempt_start, vk_errno);
+            /// Throttled calls weren't executed, they don't count against method caps
+            if(quota && (vk_errno == RESULT_TOO_MANY_REQUESTS || vk_errno == RESULT_TOO_MANY_SIMILAR_REQUESTS)) {
+                quota->Refund(method, arguments);
+            }
+            CheckContext(ctx);
+            if(!retry_policy.ShouldRetry(vk_errno, attempt, idempotent)) throw;
+            /// Server asked us to slow down: wait at least one rate limiter slot
+            milliseconds floor = (vk_errno == RESULT_TOO_MANY_REQUESTS)
+                               ? milliseconds(static_cast<int64_t>(1000 / RequestRate()))
+                               : milliseconds(0);
+            RetryBackoff(method, attempt, floor, ctx);
+        } catch(JsonException&) {
+            ReportOutcome(host, method, slot_start, attempt_start, RESULT_ERROR, true);
+            throw;
+        } catch(...) {
+            /// Cancelled or out of deadline, outcome is unknown
+            if(circuit_breakers) circuit_breakers->Release(host, method, permit);
+            if(concurrency)      concurrency->Release(host);
+            throw;
+        }
+    }
+}
+
+void
+VKAPI::ReportOutcome(const string& host, const string& method, steady_clock::time_point slot_start,
+                     steady_clock::time_point start, VKResultCode_t result, bool transport) {
+    const steady_clock::time_point now = steady_clock::now();
+    milliseconds latency = duration_cast<milliseconds>(now - start);
+
+    const bool throttled = !transport && (result == RESULT_TOO_MANY_REQUESTS ||
+                                          result == RESULT_TOO_MANY_SIMILAR_REQUESTS);
+
+    /// Adaptive limiters learn the sustainable rate from VK answers
+    if(scheduler && !transport) scheduler->getLimiter()->Feedback(latency, throttled);
+
+    if(concurrency) {
+        concurrency->Release(host, duration_cast<milliseconds>(now - slot_start), transport || throttled);
+    }
+
+    if(!circuit_breakers) return;
+
+    /// Only errors telling about VK health count, e.g. invalid params or permissions are caller's fault
+    if(transport || result == RESULT_ERROR || result == RESULT_INTERNAL_ERROR) {
+        circuit_breakers->Failure(host, method, latency, transport);
+    } else {
+        circuit_breakers->Success(host, method, latency);
+    }
+}
+
+void
+VKAPI::CheckContext(const RequestContext& ctx) {
+    if(ctx.isCancelled()) throw CancelledException("request cancelled");
+    if(ctx.isExpired())   throw DeadlineException("request deadline exceeded");
+}
+
+void
+VKAPI::Sleep(milliseconds duration, const RequestContext& ctx) {
+    /// Don't waste time on a wait that would outlive the deadline
+    if(duration >= ctx.getRemaining()) {
+        throw DeadlineException("request deadline would expire while waiting");
+    }
+
+    const steady_clock::time_point until = steady_clock::now() + duration;
+    for(;;) {
+        CheckContext(ctx);
+        steady_clock::time_point now = steady_clock::now();
+        if(now >= until) break;
+        std::this_thread::sleep_for(std::min(duration_cast<milliseconds>(until - now), VKAPI_CANCEL_POLL_INTERVAL));
+    }
 }
 
 void
-VKAPI::CustomRequest(const string& url, const string& method, const Args& arguments) {
+VKAPI::WaitRateLimit(const RequestContext& ctx) {
+    /// Shared scheduler replaces the per instance limit
+    if(scheduler) {
+        scheduler->Acquire(ctx);
+        return;
+    }
+
+    /// Make sure we won't exceed requests limit, a rate below 1 paces single requests
+    const double rate = RequestRate();
+    if(request_counter++ >= std::max(1.0, std::floor(rate))) {
+        milliseconds current_time = current_time();
+        milliseconds diff         = current_time - last_time;
+        milliseconds request_time = milliseconds(static_cast<int64_t>(1000 / rate));
+        if(diff < request_time) {
+            try {
+                Sleep(request_time, ctx);
+            } catch(libVKException&) {
+                /// Slot wasn't used
+                request_counter--;
+                throw;
+            }
+            request_counter--;
+        } else {
+            uint32_t missed = diff / request_time;
+            if(missed < request_counter) request_counter -= missed;
+            else                         request_counter  = 0;
+        }
+        last_time = current_time();
+    }
+}
+
+bool
+VKAPI::TryRateLimit() {
+    if(scheduler) return scheduler->TryAcquire();
+
+    const double rate = RequestRate();
+    if(request_counter >= std::max(1.0, std::floor(rate))) {
+        milliseconds current_time = current_time();
+        milliseconds diff         = current_time - last_time;
+        milliseconds request_time = milliseconds(static_cast<int64_t>(1000 / rate));
+        if(diff < request_time) return false;
+
+        uint32_t missed = diff / request_time;
+        if(missed < request_counter) request_counter -= missed;
+        else                         request_counter  = 0;
+        last_time = current_time();
+    }
+    request_counter++;
+    return true;
+}
+
+bool
+VKAPI::AcquireHedge(const string& method, const Args& arguments, const string& host) {
+    if(concurrency && !concurrency->TryAcquire(host)) return false;
+
+    /// The duplicate is a call of its own for VK, it is charged like one
+    if(!TryRateLimit()) {
+        if(concurrency) concurrency->Release(host);
+        return false;
+    }
+    if(quota) {
+        try {
+            quota->Charge(method, arguments);
+        } catch(QuotaExceededException&) {
+            if(concurrency) concurrency->Release(host);
+            return false;
+        }
+    }
+    return true;
+}
+
+double
+VKAPI::RequestRate() const {
+    /// Per instance limit follows the token type, read on every request so policy changes apply at once
+    const double rate = quota ? std::min(quota->getRate(), 255.0) : max_requests_per_second;
+    return rate > 0 ? rate : 1;
+}
+
+void
+VKAPI::RetryBackoff(const string& method, size_t attempt, milliseconds floor, const RequestContext& ctx) {
+    milliseconds delay = retry_policy.Backoff(attempt, floor);
+    LOG1() << method << " failed, retry #" << attempt + 1 << " in " << delay.count() << "ms";
+    Sleep(delay, ctx);
+}
+
+/// VK error response is an object with the only key "error"
+static bool is_error_body(const string& body) {
+    static const char prefix[] = "\"error\"";
+    size_t pos = body.find_first_not_of(" \t\r\n");
+    if(pos == string::npos || body[pos] != '{') return false;
+    pos = body.find_first_not_of(" \t\r\n", pos + 1);
+    return pos != string::npos && body.compare(pos, sizeof(prefix) - 1, prefix) == 0;
+}
+
+void
+VKAPI::CustomRequest(const string& url, const string& method, const Args& arguments, const RequestContext& ctx) {
     const string request_url = GenerateURL(url, method, arguments);
     LOG3() << "request url: " << escape_percent(request_url);
 
-    curl_easy_setopt(curl_handle, CURLOPT_URL, request_url.c_str());
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, VKAPI::CurlWriteDataCallback);
-    curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, &this->buffer);
-    curl_easy_setopt(curl_handle, CURLOPT_TIMEOUT_MS, 5000L);
+    /// Single attempt, retries are up to the caller's RetryPolicy
+    if(item_stream) {
+        item_stream->Reset();
+        stream_error = nullptr;
+    }
+    curl_errno = Perform(method, arguments, request_url, ctx);
 
-    /// Try curl perform max_tries times with 5s request timeout
-    size_t max_tries = 3;
-    curl_errno = CURLE_OK;
-    while((curl_errno = curl_easy_perform(curl_handle)) == CURLE_OPERATION_TIMEDOUT
-          && max_tries--);
+    /// Previous index points into the old body
+    view = JsonDocument();
+    if(item_stream) {
+        ReadStream();
+        return;
+    }
 
     if(curl_errno != CURLE_OK) {
         throw CurlException(curl_errno, curl_easy_strerror(curl_errno));
     }
 
-    ReadDataToJSON();
+    /// Errors go through the DOM, they are small and HandleError needs it
+    if(sax_handler && !is_error_body(buffer))     ReadDataToHandler();
+    else if(lazy_view && !is_error_body(buffer)) ReadDataToView();
+    else                                          ReadDataToJSON();
+}
+
+void
+VKAPI::SetupTransfer(CURL* handle, const string& request_url, string* buffer, milliseconds timeout) {
+    buffer->clear();
+    curl_easy_setopt(handle, CURLOPT_URL, request_url.c_str());
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, VKAPI::CurlWriteDataCallback);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, buffer);
+    curl_easy_setopt(handle, CURLOPT_TIMEOUT_MS, static_cast<long>(timeout.count()));
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, ssl_verify_peer ? 1L : 0L);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYHOST, ssl_verify_peer ? 2L : 0L);
+    curl_easy_setopt(handle, CURLOPT_RESOLVE, resolve_list);
+    /// Lets the kernel notice peers gone without a FIN between our probes
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    if(tls_share) curl_easy_setopt(handle, CURLOPT_SHARE, tls_share);
+}
+
+/* ##### TLS session persistence ##### */
+
+/// File is a local cache, native byte order:
+/// magic, then per session: valid_until, key flag, key, shmac, sdata with uint32 lengths
+#define TLS_SESSION_MAGIC "libvk-tls-1\n"
+
+#ifdef VKAPI_HAS_SSLS
+namespace {
+
+struct TLSSession {
+    int64_t valid_until = 0;
+    bool    has_key     = false;
+    string  key;
+    string  shmac;
+    string  sdata;
+};
+
+void put_blob(string* out, const string& blob) {
+    uint32_t size = static_cast<uint32_t>(blob.size());
+    out->append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out->append(blob);
+}
+
+bool get_blob(const string& in, size_t* pos, string* blob) {
+    uint32_t size;
+    if(in.size() - *pos < sizeof(size)) return false;
+    memcpy(&size, in.data() + *pos, sizeof(size));
+    *pos += sizeof(size);
+    if(in.size() - *pos < size) return false;
+    blob->assign(in, *pos, size);
+    *pos += size;
+    return true;
+}
+
+/// Export is an optional build feature even in new libcurl
+bool ssls_export_built_in() {
+    const curl_version_info_data* info = curl_version_info(CURLVERSION_NOW);
+    for(const char* const* name = info->feature_names; name && *name; name++) {
+        if(strcmp(*name, "SSLS-EXPORT") == 0) return true;
+    }
+    return false;
+}
+
+CURLcode export_tls_session(CURL*, void* userptr, const char* session_key,
+                            const unsigned char* shmac, size_t shmac_len,
+                            const unsigned char* sdata, size_t sdata_len,
+                            curl_off_t valid_until, int, const char*, size_t) {
+    TLSSession session;
+    session.valid_until = valid_until;
+    session.has_key     = session_key != nullptr;
+    if(session_key) session.key = session_key;
+    session.shmac.assign(reinterpret_cast<const char*>(shmac), shmac_len);
+    session.sdata.assign(reinterpret_cast<const char*>(sdata), sdata_len);
+    static_cast<vector<TLSSession>*>(userptr)->push_back(session);
+    return CURLE_OK;
+}
+
+}
+#endif
+
+void
+VKAPI::SetTLSSessionFile(const string& path) {
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    this->tls_session_file = path;
+#ifdef VKAPI_HAS_SSLS
+    if(!ssls_export_built_in()) {
+        WARNING() << "libcurl is built without SSLS-EXPORT, TLS sessions won't be saved";
+        return;
+    }
+
+    /// Sessions live in a share, so every handle of this client resumes them
+    if(!tls_share) {
+        tls_share = curl_share_init();
+        if(!tls_share) throw CurlException("curl_share_init() failed");
+        curl_share_setopt(tls_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+        curl_easy_setopt(curl_handle, CURLOPT_SHARE, tls_share);
+    }
+    LoadTLSSessions();
+#else
+    WARNING() << "TLS session persistence needs libcurl 8.12 or newer, built with "
+              << LIBCURL_VERSION << ", sessions won't be saved";
+#endif
+}
+
+size_t
+VKAPI::LoadTLSSessions() {
+#ifdef VKAPI_HAS_SSLS
+    if(!tls_share) return 0;
+
+    std::ifstream file(tls_session_file, std::ios::binary);
+    if(!file) return 0;
+
+    std::stringstream ss;
+    ss << file.rdbuf();
+    const string data = ss.str();
+
+    const string magic = TLS_SESSION_MAGIC;
+    if(data.compare(0, magic.size(), magic) != 0) {
+        WARNING() << tls_session_file << " is not a TLS session file, ignored";
+        return 0;
+    }
+
+    size_t loaded = 0;
+    const int64_t now = static_cast<int64_t>(time(nullptr));
+    size_t pos = magic.size();
+    for(;;) {
+        TLSSession session;
+        string     has_key;
+        if(data.size() - pos < sizeof(session.valid_until)) break;
+        memcpy(&session.valid_until, data.data() + pos, sizeof(session.valid_until));
+        pos += sizeof(session.valid_until);
+
+        if(!get_blob(data, &pos, &has_key) || !get_blob(data, &pos, &session.key) ||
+           !get_blob(data, &pos, &session.shmac) || !get_blob(data, &pos, &session.sdata)) {
+            break;
+        }
+        if(session.valid_until && session.valid_until <= now) continue;
+
+        CURLcode err = curl_easy_ssls_import(curl_handle, has_key == "1" ? session.key.c_str() : nullptr,
+                                             reinterpret_cast<const unsigned char*>(session.shmac.data()),
+                                             session.shmac.size(),
+                                             reinterpret_cast<const unsigned char*>(session.sdata.data()),
+                                             session.sdata.size());
+        if(err == CURLE_OK) loaded++;
+        else LOG2() << "TLS session import failed: " << curl_easy_strerror(err);
+    }
+    LOG2() << "loaded " << loaded << " TLS sessions from " << tls_session_file;
+    return loaded;
+#else
+    return 0;
+#endif
+}
+
+bool
+VKAPI::SaveTLSSessions() {
+#ifdef VKAPI_HAS_SSLS
+    /// Health checker transfers use the same share
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    if(tls_session_file.empty() || !tls_share) return false;
+
+    vector<TLSSession> sessions;
+    CURLcode err = curl_easy_ssls_export(curl_handle, export_tls_session, &sessions);
+    if(err != CURLE_OK) {
+        WARNING() << "TLS session export failed: " << curl_easy_strerror(err);
+        return false;
+    }
+    if(sessions.empty()) return false;
+
+    string data = TLS_SESSION_MAGIC;
+    for(const TLSSession& session : sessions) {
+        data.append(reinterpret_cast<const char*>(&session.valid_until), sizeof(session.valid_until));
+        put_blob(&data, session.has_key ? "1" : "0");
+        put_blob(&data, session.key);
+        put_blob(&data, session.shmac);
+        put_blob(&data, session.sdata);
+    }
+
+    /// Sessions are secrets: owner only, and replaced atomically so concurrent workers never read a torn file.
+    /// mkstemp() names the temporary uniquely, clients of one process share the pid.
+    vector<char> name(tls_session_file.begin(), tls_session_file.end());
+    const string suffix = ".XXXXXX";
+    name.insert(name.end(), suffix.begin(), suffix.end());
+    name.push_back('\0');
+    int fd = mkstemp(name.data());
+    const string tmp = name.data();
+    if(fd < 0) {
+        WARNING() << "can't write " << tmp << ": " << strerror(errno);
+        return false;
+    }
+    bool ok = write(fd, data.data(), data.size()) == static_cast<ssize_t>(data.size());
+    ok = (close(fd) == 0) && ok;
+    if(!ok || rename(tmp.c_str(), tls_session_file.c_str()) != 0) {
+        WARNING() << "can't save TLS sessions to " << tls_session_file << ": " << strerror(errno);
+        unlink(tmp.c_str());
+        return false;
+    }
+
+    LOG2() << "saved " << sessions.size() << " TLS sessions to " << tls_session_file;
+    return true;
+#else
+    return false;
+#endif
+}
+
+CURLcode
+VKAPI::Perform(const string& method, const Args& arguments, const string& request_url, const RequestContext& ctx) {
+    CheckContext(ctx);
+
+    /// Transfer can't outlive the call deadline
+    const milliseconds remaining   = ctx.getRemaining();
+    const milliseconds policy      = timeout_policy.Timeout(method);
+    const bool         capped      = remaining < policy;
+    const milliseconds timeout     = capped ? remaining : policy;
+    /// Twin transfers can't both feed a stream
+    const milliseconds hedge_delay = item_stream ? milliseconds(0) : timeout_policy.HedgeDelay(method);
+
+    RefreshPinnedHosts();
+
+    /// Health checker probes the same multi handle between requests
+    std::lock_guard<std::mutex> curl_lock(curl_mtx);
+    last_transfer = steady_clock::now();
+
+    SetupTransfer(curl_handle, request_url, &buffer, timeout);
+    if(item_stream) {
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEFUNCTION, VKAPI::CurlStreamCallback);
+        curl_easy_setopt(curl_handle, CURLOPT_WRITEDATA, this);
+    }
+    curl_multi_add_handle(curl_multi, curl_handle);
+
+    const steady_clock::time_point start = steady_clock::now();
+    steady_clock::time_point hedge_start = start;
+
+    const string host = url_host(request_url);
+
+    bool     hedged    = false;
+    bool     hedge_out = false;     ///< Hedge was sent, holding its own permits
+    size_t   running   = 1;
+    CURL*    winner    = nullptr;
+    CURL*    fallback  = nullptr;   ///< Finished with a VK error while its twin was in flight
+    CURLcode result    = CURLE_OK;
+
+    while(!winner) {
+        int still_running = 0;
+        curl_multi_perform(curl_multi, &still_running);
+
+        CURLMsg* msg;
+        int      msgs_left;
+        while(!winner && (msg = curl_multi_info_read(curl_multi, &msgs_left))) {
+            if(msg->msg != CURLMSG_DONE) continue;
+            CURL* handle = msg->easy_handle;
+            result       = msg->data.result;
+            curl_multi_remove_handle(curl_multi, handle);
+
+            /// A failed transfer or a VK error, e.g. a quick "too many requests" to the
+            /// hedge, loses if its twin is still in flight, it may yet succeed
+            const string& body = (handle == hedge_handle) ? hedge_buffer : buffer;
+            const bool    good = result == CURLE_OK && !(hedge_out && is_error_body(body));
+            if(good || --running == 0) {
+                winner = handle;
+            } else if(result == CURLE_OK && !fallback) {
+                fallback = handle;
+            }
+        }
+        /// Both lost: an answer, even an error one, beats a transport failure
+        if(winner && result != CURLE_OK && fallback) {
+            winner = fallback;
+            result = CURLE_OK;
+        }
+        if(winner) break;
+
+        if(ctx.isCancelled() || ctx.isExpired()) {
+            curl_multi_remove_handle(curl_multi, curl_handle);
+            if(hedge_handle) curl_multi_remove_handle(curl_multi, hedge_handle);
+            if(hedge_out && concurrency) concurrency->Release(host);
+            CheckContext(ctx);
+        }
+
+        milliseconds elapsed = duration_cast<milliseconds>(steady_clock::now() - start);
+        if(!hedged && hedge_delay.count() && elapsed >= hedge_delay) {
+            if(!hedge_handle) hedge_handle = curl_easy_init();
+            /// The duplicate goes out only within rate limit, quota and concurrency, or not at all
+            if(hedge_handle && AcquireHedge(method, arguments, host)) {
+                hedge_out = true;
+                LOG2() << method << " is slower than " << hedge_delay.count() << "ms, sending hedged request";
+                SetupTransfer(hedge_handle, request_url, &hedge_buffer, timeout);
+                curl_multi_add_handle(curl_multi, hedge_handle);
+                hedge_start = steady_clock::now();
+                running++;
+            }
+            hedged = true;
+        }
+
+        /// Wake up often enough to notice cancellation
+        milliseconds wait = VKAPI_CANCEL_POLL_INTERVAL;
+        if(!hedged && hedge_delay.count()) wait = std::min(wait, std::max(hedge_delay - elapsed, milliseconds(1)));
+        curl_multi_wait(curl_multi, nullptr, 0, static_cast<int>(wait.count()), nullptr);
+    }
+
+    /// Abort the loser, if any
+    curl_multi_remove_handle(curl_multi, curl_handle);
+    if(hedge_handle) curl_multi_remove_handle(curl_multi, hedge_handle);
+    if(hedge_out && concurrency) concurrency->Release(host);
+    last_transfer = steady_clock::now();
+
+    steady_clock::time_point winner_start = start;
+    if(winner == hedge_handle) {
+        LOG2() << "hedged request for " << method << " won";
+        buffer.swap(hedge_buffer);
+        winner_start = hedge_start;
+    }
+
+    /// Timed out requests are recorded too, otherwise a slowdown could never raise the timeout
+    if(result == CURLE_OK || (result == CURLE_OPERATION_TIMEDOUT && !capped)) {
+        timeout_policy.Record(method, duration_cast<milliseconds>(steady_clock::now() - winner_start));
+    }
+
+    if(result == CURLE_OPERATION_TIMEDOUT && capped) {
+        throw DeadlineException("request deadline exceeded");
+    }
+
+    return result;
 }
 
 void
@@ -183,11 +1143,36 @@ VKAPI::GenerateURL(const string& url, const string& method, const Args& args) {
     return escape_spaces(ss.str());
 }
 
+size_t
+VKAPI::CurlDiscardCallback(void*, size_t size, size_t nmemb, void*) {
+    return size*nmemb;
+}
+
+size_t
+VKAPI::CurlStreamCallback(void* contents, size_t size, size_t nmemb, void* useptr) {
+    VKAPI* api   = reinterpret_cast<VKAPI*>(useptr);
+    char*  data  = reinterpret_cast<char*>(contents);
+    size_t bytes = size*nmemb;
+
+    /// Exceptions can't cross curl, returning less than given aborts the transfer
+    try {
+        if(!api->item_stream->Feed(data, bytes)) return 0;
+    } catch(...) {
+        api->stream_error = std::current_exception();
+        return 0;
+    }
+
+    /// Body is kept until it turns out to be a response, errors need the DOM
+    if(!api->item_stream->isResponse()) api->buffer.append(data, bytes);
+    else if(!api->buffer.empty())       api->buffer.clear();
+    return bytes;
+}
+
 size_t
 VKAPI::CurlWriteDataCallback(void* contents, size_t size, size_t nmemb, void* useptr) {
     string* buffer = reinterpret_cast<string*>(useptr);
     char*   data   = reinterpret_cast<char*>(contents);
-    buffer->append(data);
+    buffer->append(data, size*nmemb);
     return size*nmemb;
 }
 
@@ -196,12 +1181,53 @@ VKAPI::ReadDataToJSON() {
     json.clear();
     Reader reader;
 
+    /// Body is kept for getRawBody() until the next request
     if(!reader.parse(buffer, json, false)) {
-        buffer.clear();
         throw JsonException(reader.getFormattedErrorMessages());
     }
+}
+
+void
+VKAPI::ReadDataToHandler() {
+    json = Value();
+
+    string error;
+    if(!JsonPushParser::Parse(buffer.data(), buffer.size(), *sax_handler, &error)) {
+        throw JsonException(error);
+    }
+}
+
+void
+VKAPI::ReadDataToView() {
+    json = Value();
+
+    if(!view.Reset(buffer.data(), buffer.size())) {
+        throw JsonException(view.getError());
+    }
+}
+
+void
+VKAPI::ReadStream() {
+    json = Value();
+
+    if(stream_error) std::rethrow_exception(stream_error);
+    if(item_stream->hasError()) throw JsonException(item_stream->getError());
+
+    if(curl_errno != CURLE_OK) {
+        /// Items can't be taken back, a retry would deliver them twice
+        if(item_stream->getItems()) {
+            throw StreamException("response stream broke after " + to_string(item_stream->getItems()) +
+                                  " items: " + curl_easy_strerror(curl_errno));
+        }
+        throw CurlException(curl_errno, curl_easy_strerror(curl_errno));
+    }
 
-    buffer.clear();
+    /// Errors were buffered whole for HandleError
+    if(!item_stream->isResponse()) {
+        ReadDataToJSON();
+        return;
+    }
+    if(!item_stream->Finish()) throw JsonException(item_stream->getError());
 }
 
 /* ##### SETTERS ##### */
@@ -236,6 +1262,84 @@ VKAPI::SetMaxRequestsPerSec(const uint8_t max_requests) {
     this->max_requests_per_second = max_requests;
 }
 
+void
+VKAPI::SetRetryPolicy(const RetryPolicy& policy) {
+    this->retry_policy = policy;
+}
+
+void
+VKAPI::SetRequestContext(const RequestContext& ctx) {
+    this->context = ctx;
+}
+
+void
+VKAPI::SetCircuitBreakers(const std::shared_ptr<CircuitBreakerGroup>& breakers) {
+    this->circuit_breakers = breakers;
+}
+
+void
+VKAPI::SetSingleFlight(const std::shared_ptr<SingleFlight>& single_flight) {
+    this->single_flight = single_flight;
+}
+
+void
+VKAPI::SetScheduler(const std::shared_ptr<RequestScheduler>& scheduler) {
+    this->scheduler = scheduler;
+}
+
+void
+VKAPI::SetQuotaPolicy(const std::shared_ptr<QuotaPolicy>& quota) {
+    /// Per instance limit follows the token type from now on, see RequestRate(); a scheduler has its own limiter
+    this->quota = quota;
+}
+
+void
+VKAPI::SetConcurrencyController(const std::shared_ptr<ConcurrencyController>& concurrency) {
+    this->concurrency = concurrency;
+}
+
+void
+VKAPI::SetAdaptiveRate(double min_rate, double max_rate) {
+    /// Private scheduler over an AIMD limiter starting from the static limit
+    double initial = std::min(std::max(RequestRate(), min_rate), max_rate);
+    this->scheduler = std::make_shared<RequestScheduler>(
+                std::make_shared<AdaptiveRateLimiter>(initial, min_rate, max_rate));
+}
+
+void
+VKAPI::SetTimeoutPolicy(const TimeoutPolicy& policy) {
+    this->timeout_policy = policy;
+}
+
+void
+VKAPI::SetAPIUrl(const string& url) {
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    this->api_url = url;
+}
+
+void
+VKAPI::SetAuthUrl(const string& url) {
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    this->auth_url = url;
+}
+
+void
+VKAPI::SetDNSRefresh(milliseconds period) {
+    this->dns_refresh = period;
+}
+
+void
+VKAPI::SetJsonBackend(JsonBackend backend) {
+    this->response.SetBackend(backend);
+}
+
+void
+VKAPI::SetSSLVerifyPeer(bool verify) {
+    /// Needed to talk to a local endpoint with self-signed certificate, e.g. mockserver
+    std::lock_guard<std::mutex> lock(curl_mtx);
+    this->ssl_verify_peer = verify;
+}
+
 /* ##### GETTERS ##### */
 
 CURLcode
@@ -243,14 +1347,84 @@ VKAPI::getCurlError() const {
     return curl_errno;
 }
 
+VKResultCode_t
+VKAPI::getVKError() const {
+    return vk_errno;
+}
+
+const RetryPolicy&
+VKAPI::getRetryPolicy() const {
+    return retry_policy;
+}
+
+const RequestContext&
+VKAPI::getRequestContext() const {
+    return context;
+}
+
+const std::shared_ptr<CircuitBreakerGroup>&
+VKAPI::getCircuitBreakers() const {
+    return circuit_breakers;
+}
+
+const std::shared_ptr<SingleFlight>&
+VKAPI::getSingleFlight() const {
+    return single_flight;
+}
+
+const std::shared_ptr<RequestScheduler>&
+VKAPI::getScheduler() const {
+    return scheduler;
+}
+
+const std::shared_ptr<QuotaPolicy>&
+VKAPI::getQuotaPolicy() const {
+    return quota;
+}
+
+const std::shared_ptr<ConcurrencyController>&
+VKAPI::getConcurrencyController() const {
+    return concurrency;
+}
+
+const TimeoutPolicy&
+VKAPI::getTimeoutPolicy() const {
+    return timeout_policy;
+}
+
 const VKValue&
 VKAPI::getJSON() const {
     return json;
 }
 
+const string&
+VKAPI::getRawBody() const {
+    return buffer;
+}
+
+const JsonDocument&
+VKAPI::getView() const {
+    return view;
+}
+
+JsonBackend
+VKAPI::getJsonBackend() const {
+    return response.getConfiguredBackend();
+}
+
 const string&
 VKAPI::getAccessToken() const {
     return def_access_token;
 }
 
+const string&
+VKAPI::getAPIUrl() const {
+    return api_url;
+}
+
+const string&
+VKAPI::getAuthUrl() const {
+    return auth_url;
+}
+
 }
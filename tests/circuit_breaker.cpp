@@ -0,0 +1,138 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "circuit_breaker.hpp"
+#include <thread>
+
+using namespace vk;
+
+/// Judges after 4 outcomes, probes after 20ms with 2 trials
+static CircuitBreakerSettings quick() {
+    CircuitBreakerSettings settings;
+    settings.window          = 4;
+    settings.min_calls       = 4;
+    settings.error_ratio     = 0.5;
+    settings.slow_call       = milliseconds(100);
+    settings.slow_ratio      = 0.75;
+    settings.open_duration   = milliseconds(20);
+    settings.half_open_calls = 2;
+    return settings;
+}
+
+static void wait_open(const CircuitBreakerSettings& settings) {
+    std::this_thread::sleep_for(settings.open_duration + milliseconds(5));
+}
+
+TEST(breaker_opens_on_errors) {
+    CircuitBreaker breaker(quick());
+
+    breaker.OnFailure();
+    breaker.OnFailure();
+    breaker.OnSuccess(milliseconds(1));
+    CHECK_EQ(breaker.getState(), CircuitBreaker::CLOSED);   ///< Too few outcomes to judge
+    breaker.OnSuccess(milliseconds(1));
+    CHECK_EQ(breaker.getState(), CircuitBreaker::OPEN);     ///< 2 of 4 failed
+    CHECK(!breaker.Allow());
+}
+
+TEST(breaker_opens_on_slow_calls) {
+    CircuitBreaker breaker(quick());
+
+    for(int i = 0; i < 3; i++) breaker.OnSuccess(milliseconds(200));
+    breaker.OnSuccess(milliseconds(1));
+    CHECK_EQ(breaker.getState(), CircuitBreaker::OPEN);
+}
+
+TEST(breaker_window_slides) {
+    CircuitBreaker breaker(quick());
+
+    breaker.OnFailure();
+    for(int i = 0; i < 20; i++) breaker.OnSuccess(milliseconds(1));
+    /// The old failure left the window, one new one is below the ratio
+    breaker.OnFailure();
+    CHECK_EQ(breaker.getState(), CircuitBreaker::CLOSED);
+}
+
+TEST(breaker_half_open_closes) {
+    const CircuitBreakerSettings settings = quick();
+    CircuitBreaker breaker(settings);
+    for(int i = 0; i < 4; i++) breaker.OnFailure();
+    CHECK_EQ(breaker.getState(), CircuitBreaker::OPEN);
+
+    wait_open(settings);
+    bool trial = false;
+    CHECK(breaker.Allow(&trial) && trial);
+    CHECK_EQ(breaker.getState(), CircuitBreaker::HALF_OPEN);
+    CHECK(breaker.Allow(&trial) && trial);
+    CHECK(!breaker.Allow());                                ///< Trial slots taken
+
+    breaker.OnSuccess(milliseconds(1));
+    CHECK_EQ(breaker.getState(), CircuitBreaker::HALF_OPEN);
+    breaker.OnSuccess(milliseconds(1));
+    CHECK_EQ(breaker.getState(), CircuitBreaker::CLOSED);
+    CHECK(breaker.Allow(&trial) && !trial);
+}
+
+TEST(breaker_half_open_reopens) {
+    const CircuitBreakerSettings settings = quick();
+
+    CircuitBreaker failing(settings);
+    for(int i = 0; i < 4; i++) failing.OnFailure();
+    wait_open(settings);
+    CHECK(failing.Allow());
+    failing.OnFailure();
+    CHECK_EQ(failing.getState(), CircuitBreaker::OPEN);
+    CHECK(!failing.Allow());
+
+    CircuitBreaker slow(settings);
+    for(int i = 0; i < 4; i++) slow.OnFailure();
+    wait_open(settings);
+    CHECK(slow.Allow());
+    slow.OnSuccess(milliseconds(200));
+    CHECK_EQ(slow.getState(), CircuitBreaker::OPEN);
+}
+
+TEST(breaker_release_returns_trials_only) {
+    const CircuitBreakerSettings settings = quick();
+    CircuitBreakerGroup group(settings);
+
+    CircuitBreakerPermit closed;
+    CHECK(group.Allow("host", "users.get", closed));
+    CHECK(!closed.host_trial && !closed.method_trial);
+
+    for(int i = 0; i < 4; i++) group.Failure("host", "users.get", milliseconds(1), false);
+    CHECK_EQ(group.getMethodState("users.get"), CircuitBreaker::OPEN);
+    wait_open(settings);
+
+    CircuitBreakerPermit first, second, third;
+    CHECK(group.Allow("host", "users.get", first) && first.method_trial);
+    CHECK(group.Allow("host", "users.get", second) && second.method_trial);
+    CHECK(!group.Allow("host", "users.get", third));
+
+    /// Call let through while closed holds no trial slot to give back
+    group.Release("host", "users.get", closed);
+    CHECK(!group.Allow("host", "users.get", third));
+
+    group.Release("host", "users.get", first);
+    CHECK(group.Allow("host", "users.get", third) && third.method_trial);
+}
+
+TEST(breaker_group_isolates_methods) {
+    CircuitBreakerGroup group(quick());
+
+    /// API errors: the method is in trouble, the host answered
+    for(int i = 0; i < 4; i++) group.Failure("host", "wall.post", milliseconds(1), false);
+    CHECK_EQ(group.getMethodState("wall.post"), CircuitBreaker::OPEN);
+    CHECK_EQ(group.getHostState("host"), CircuitBreaker::CLOSED);
+
+    CircuitBreakerPermit permit;
+    CHECK(!group.Allow("host", "wall.post", permit));
+    CHECK(group.Allow("host", "users.get", permit));
+
+    /// Transport errors: the host is down, every method on it stops
+    for(int i = 0; i < 4; i++) group.Failure("host", "users.get", milliseconds(1), true);
+    CHECK_EQ(group.getHostState("host"), CircuitBreaker::OPEN);
+    CHECK(!group.Allow("host", "friends.get", permit));
+    CHECK(group.Allow("other", "friends.get", permit));
+}
@@ -0,0 +1,48 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "columns.hpp"
+
+using namespace vk;
+
+TEST(columns_append_and_truncate) {
+    ColumnSet columns;
+    const size_t id   = columns.AddColumn("id",      ColumnSet::COLUMN_ID);
+    const size_t city = columns.AddColumn("city.id", ColumnSet::COLUMN_INT);
+    const size_t name = columns.AddColumn("name",    ColumnSet::COLUMN_STRING);
+
+    ArenaDocument doc;
+    const char* items[] = {
+        "{\"id\": 1, \"city\": {\"id\": 2}, \"name\": \"one\"}",
+        "{\"id\": 3, \"name\": 5}",
+        "{\"id\": 4, \"city\": {\"id\": 6}, \"name\": \"four\"}"
+    };
+    for(const char* item : items) {
+        CHECK(doc.Parse(item, strlen(item)));
+        columns.Append(doc.getRoot());
+    }
+
+    CHECK_EQ(columns.getRows(), 3u);
+    CHECK_EQ(columns.getIDs(id)[2], 4);
+    CHECK_EQ(columns.getInts(city)[1], 0);            ///< Missing
+    CHECK(columns.getString(name, 1).empty());        ///< Mistyped
+    CHECK_EQ(columns.getString(name, 2).str(), "four");
+
+    /// Rows of a failed page go, every column shrinks alike
+    columns.Truncate(1);
+    CHECK_EQ(columns.getRows(), 1u);
+    CHECK_EQ(columns.getIDs(id).size(), 1u);
+    CHECK_EQ(columns.getInts(city).size(), 1u);
+    CHECK(columns.getString(name, 1).empty());
+
+    CHECK(doc.Parse(items[2], strlen(items[2])));
+    columns.Append(doc.getRoot());
+    CHECK_EQ(columns.getString(name, 0).str(), "one");
+    CHECK_EQ(columns.getString(name, 1).str(), "four");
+    CHECK_EQ(columns.getInts(city)[1], 6);
+
+    /// Columns added later are filled with defaults for rows before them
+    const size_t late = columns.AddColumn("rate", ColumnSet::COLUMN_DOUBLE);
+    CHECK_EQ(columns.getDoubles(late).size(), 2u);
+}
@@ -0,0 +1,49 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "log.hpp"
+#include <iostream>
+#include <string.h>
+
+namespace test {
+
+static size_t failed_checks = 0;
+
+std::vector<Case>&
+cases() {
+    static std::vector<Case> registered;
+    return registered;
+}
+
+void
+Fail(const char* file, int line, const std::string& what) {
+    failed_checks++;
+    std::cerr << file << ":" << line << ": CHECK(" << what << ") failed" << std::endl;
+}
+
+}
+
+/// Runs every case, or those whose name contains argv[1]. Exit status is 1 if any check failed.
+int main(int argc, char** argv) {
+    mlog::log_level = mlog::error;
+
+    size_t run = 0, failed = 0;
+    for(const test::Case& c : test::cases()) {
+        if(argc > 1 && !strstr(c.name, argv[1])) continue;
+
+        const size_t before = test::failed_checks;
+        try {
+            c.function();
+        } catch(std::exception& e) {
+            test::Fail(c.name, 0, std::string("unexpected exception: ") + e.what());
+        }
+        const bool ok = test::failed_checks == before;
+        std::cout << (ok ? "[  OK  ] " : "[FAILED] ") << c.name << std::endl;
+        run++;
+        failed += ok ? 0 : 1;
+    }
+
+    std::cout << run - failed << " of " << run << " tests passed" << std::endl;
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,202 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "vkapi.hpp"
+#include "sax.hpp"
+#include "json_scan.hpp"
+#include "json_view.hpp"
+#include "json_pointer.hpp"
+#include "arena.hpp"
+
+using namespace vk;
+
+/// Events as text, to compare parses
+struct Recorder : public JsonHandler {
+    string events;
+    bool Null()                 { events += "n ";                                return true; }
+    bool Bool  (bool value)     { events += value ? "t " : "f ";                 return true; }
+    bool Int64 (int64_t value)  { events += "i" + std::to_string(value) + " ";   return true; }
+    bool Uint64(uint64_t value) { events += "u" + std::to_string(value) + " ";   return true; }
+    bool Double(double value)   { events += "d" + std::to_string(value) + " ";   return true; }
+    bool String(StringRef value){ events += "s:" + value.str() + " ";            return true; }
+    bool Key   (StringRef key)  { events += "k:" + key.str() + " ";              return true; }
+    bool StartObject()          { events += "{ ";                                return true; }
+    bool EndObject()            { events += "} ";                                return true; }
+    bool StartArray()           { events += "[ ";                                return true; }
+    bool EndArray()             { events += "] ";                                return true; }
+};
+
+static const string sample =
+    "{\"response\": {\"count\": 3, \"items\": ["
+    "{\"id\": 1, \"first_name\": \"Pavel\", \"rate\": 4.5, \"verified\": true},"
+    "{\"id\": -9223372036854775808, \"first_name\": \"\\u0410\\u043d\\u044f \\\"A\\\"\", \"city\": null},"
+    "{\"id\": 18446744073709551615, \"first_name\": \"\", \"tags\": [], \"extra\": {}}"
+    "]}}";
+
+TEST(sax_events) {
+    Recorder recorder;
+    CHECK(JsonPushParser::Parse(sample.data(), sample.size(), recorder));
+    CHECK(recorder.events.find("k:id i1 ") != string::npos);
+    CHECK(recorder.events.find("i-9223372036854775808 ") != string::npos);
+    CHECK(recorder.events.find("u18446744073709551615 ") != string::npos);
+    CHECK(recorder.events.find("s:\xD0\x90\xD0\xBD\xD1\x8F \"A\" ") != string::npos);
+    CHECK(recorder.events.find("k:tags [ ] k:extra { } ") != string::npos);
+}
+
+TEST(sax_chunks_split_anywhere) {
+    Recorder whole;
+    CHECK(JsonPushParser::Parse(sample.data(), sample.size(), whole));
+
+    for(size_t split = 1; split < sample.size(); split++) {
+        Recorder chunked;
+        JsonPushParser parser(chunked);
+        CHECK(parser.Feed(sample.data(), split));
+        CHECK(parser.Feed(sample.data() + split, sample.size() - split));
+        CHECK(parser.Finish());
+        CHECK_EQ(chunked.events, whole.events);
+    }
+}
+
+TEST(sax_errors) {
+    const char* broken[] = { "", "{", "[1,]", "{\"a\" 1}", "[1 2]", "tru", "\"\\x\"", "[1]]", "{\"a\":01}" };
+    for(const char* text : broken) {
+        Recorder recorder;
+        string   error;
+        CHECK(!JsonPushParser::Parse(text, strlen(text), recorder, &error));
+        CHECK(!error.empty() || strlen(text) == 0);
+    }
+
+    /// Nesting limit
+    Recorder recorder;
+    JsonPushParser parser(recorder, 4);
+    CHECK(!parser.Feed("[[[[[1]]]]]", 11));
+}
+
+TEST(scan_integer) {
+    uint64_t magnitude;
+    bool     negative;
+    CHECK(scan_integer("0", 1, &magnitude, &negative) && magnitude == 0 && !negative);
+    CHECK(scan_integer("-42", 3, &magnitude, &negative) && magnitude == 42 && negative);
+    CHECK(scan_integer("123456789012345678", 18, &magnitude, &negative) && magnitude == 123456789012345678ULL);
+    CHECK(scan_integer("18446744073709551615", 20, &magnitude, &negative) && magnitude == 18446744073709551615ULL);
+    CHECK(!scan_integer("18446744073709551616", 20, &magnitude, &negative));
+    CHECK(!scan_integer("1.5", 3, &magnitude, &negative));
+    CHECK(!scan_integer("1e3", 3, &magnitude, &negative));
+    CHECK(!scan_integer("-", 1, &magnitude, &negative));
+    CHECK(!scan_integer("", 0, &magnitude, &negative));
+}
+
+TEST(scan_structure_levels_agree) {
+    string text;
+    for(int i = 0; i < 50; i++) text += sample + " \"a,b[c]\\\"{\" ";
+
+    const SimdLevel best = simd_level();
+    vector<uint32_t> scalar;
+    set_simd_level(SIMD_SCALAR);
+    CHECK(scan_structure(text.data(), text.size(), scalar));
+    for(SimdLevel level : {SIMD_SSE2, SIMD_AVX2}) {
+        vector<uint32_t> vectorized;
+        set_simd_level(level);
+        CHECK(scan_structure(text.data(), text.size(), vectorized));
+        CHECK(vectorized == scalar);
+    }
+    set_simd_level(best);
+
+    vector<uint32_t> positions;
+    CHECK(!scan_structure("[\"open", 6, positions));
+    CHECK_EQ(positions.back(), 1u);
+}
+
+TEST(view_document) {
+    JsonDocument doc(sample);
+    CHECK(doc.isValid());
+
+    JsonView items = doc.getRoot()["response"]["items"];
+    CHECK(items.isArray());
+    CHECK_EQ(items.size(), 3u);
+    CHECK_EQ(doc.getRoot()["response"]["count"].asInt(), 3);
+    CHECK_EQ(items[0]["first_name"].asString(), "Pavel");
+    CHECK_EQ(items[0]["rate"].asDouble(), 4.5);
+    CHECK(items[0]["verified"].asBool());
+    CHECK_EQ(items[1]["first_name"].asString(), "\xD0\x90\xD0\xBD\xD1\x8F \"A\"");
+    CHECK(items[1]["city"].isNull());
+    CHECK_EQ(items[1]["id"].asInt64(), INT64_MIN);
+    CHECK_EQ(items[2]["id"].asUInt64(), UINT64_MAX);
+    CHECK_EQ(items[2]["tags"].size(), 0u);
+    CHECK_EQ(items[2]["extra"].size(), 0u);
+    CHECK(!items[3].exists());
+    CHECK(!items[0]["missing"].exists());
+    CHECK_EQ(items[0]["missing"].asInt(7), 7);
+
+    size_t count = 0;
+    for(JsonView::Iterator it = items[0].begin(); it != items[0].end(); ++it) count++;
+    CHECK_EQ(count, items[0].size());
+}
+
+TEST(view_integer_range) {
+    const string text = "[1e300, -1e300, 3000000000, 2.9, -1, 1e3]";
+    JsonDocument doc(text);
+    JsonView root = doc.getRoot();
+    CHECK_EQ(root[0].asInt64(5), 5);
+    CHECK_EQ(root[1].asInt64(5), 5);
+    CHECK_EQ(root[2].asInt(5), 5);
+    CHECK_EQ(root[2].asInt64(), 3000000000LL);
+    CHECK_EQ(root[3].asInt(), 2);
+    CHECK_EQ(root[4].asUInt64(5), 5u);
+    CHECK_EQ(root[5].asInt(), 1000);
+}
+
+TEST(view_rejects_broken_structure) {
+    const char* broken[] = { "", "  ", "{", "[1,]", "{\"a\" 1}", "[1 2]", "[1]]", "{\"a\":1,}", "[\"x]", "1 2", "{1:2}" };
+    for(const char* text : broken) {
+        JsonDocument doc(text, strlen(text));
+        CHECK(!doc.isValid());
+        CHECK(!doc.getRoot().exists());
+    }
+    CHECK(JsonDocument(" 42 ").getRoot().asInt() == 42);
+}
+
+TEST(arena_document) {
+    ArenaDocument doc;
+    CHECK(doc.Parse(sample));
+
+    ArenaValue items = doc.getRoot()["response"]["items"];
+    CHECK_EQ(items.size(), 3u);
+    CHECK_EQ(items[0]["first_name"].asString(), "Pavel");
+    CHECK_EQ(items[1]["id"].asInt64(), INT64_MIN);
+    CHECK_EQ(items[2]["id"].asUInt64(), UINT64_MAX);
+    CHECK_EQ(items[2]["id"].asInt64(5), 5);
+    CHECK(!items[3].exists());
+
+    CHECK(doc.Parse("[1e300, 2.5]"));
+    CHECK_EQ(doc.getRoot()[0].asInt64(5), 5);
+    CHECK_EQ(doc.getRoot()[1].asInt(), 2);
+
+    CHECK(!doc.Parse("{\"a\":"));
+    CHECK(!doc.getError().empty());
+}
+
+TEST(json_pointer) {
+    JsonDocument doc(sample);
+
+    CHECK_EQ(JsonPointer("/response/count").Get(doc.getRoot()).asInt(), 3);
+    CHECK_EQ(JsonPointer("/response/items/2/id").Get(doc.getRoot()).asUInt64(), UINT64_MAX);
+    CHECK(!JsonPointer("/response/items/3").Get(doc.getRoot()).exists());
+    CHECK_EQ(JsonPointer("").Get(doc.getRoot()).getRaw().size, sample.size());
+
+    vector<JsonView> found;
+    JsonPointer ids("/response/items/*/first_name");
+    CHECK(ids.isWildcard());
+    ids.Select(doc.getRoot(), found);
+    CHECK_EQ(found.size(), 3u);
+    CHECK_EQ(found[0].asString(), "Pavel");
+
+    const string text = "{\"a/b\": {\"c~d\": 1}}";
+    JsonDocument escaped(text);
+    CHECK_EQ(JsonPointer("/a~1b/c~0d").Get(escaped.getRoot()).asInt(), 1);
+
+    bool thrown = false;
+    try { JsonPointer("no/slash"); } catch(JsonException&) { thrown = true; }
+    CHECK(thrown);
+}
@@ -0,0 +1,70 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "rate_limiter.hpp"
+
+using namespace vk;
+
+TEST(token_bucket_burst) {
+    TokenBucket bucket(10.0, 3.0);
+    milliseconds wait(0);
+
+    for(int i = 0; i < 3; i++) CHECK(bucket.TryAcquire(1.0, &wait));
+    CHECK(!bucket.TryAcquire(1.0, &wait));
+    /// A permit every 100ms
+    CHECK(wait > milliseconds(0) && wait <= milliseconds(100));
+}
+
+TEST(adaptive_rate_aimd) {
+    AdaptiveRateLimiter limiter(10.0, 1.0, 20.0);
+    limiter.SetDecrease(0.5, milliseconds(0));
+
+    for(int i = 0; i < 10; i++) limiter.Feedback(milliseconds(50), false);
+    CHECK(limiter.getRate() > 10.0);
+    CHECK_EQ(limiter.getBaseline(), 50.0);
+
+    const double rate = limiter.getRate();
+    limiter.Feedback(milliseconds(50), true);
+    CHECK_EQ(limiter.getRate(), rate * 0.5);
+    CHECK_EQ(limiter.getThrottled(), 1u);
+
+    /// Never below min_rate nor above max_rate
+    for(int i = 0; i < 20; i++) limiter.Feedback(milliseconds(50), true);
+    CHECK_EQ(limiter.getRate(), 1.0);
+    for(int i = 0; i < 10000; i++) limiter.Feedback(milliseconds(50), false);
+    CHECK_EQ(limiter.getRate(), 20.0);
+}
+
+TEST(adaptive_rate_latency_spike) {
+    AdaptiveRateLimiter limiter(10.0, 1.0, 100.0);
+    limiter.SetDecrease(0.5, milliseconds(0));
+
+    for(int i = 0; i < 30; i++) limiter.Feedback(milliseconds(50), false);
+    const double rate = limiter.getRate();
+    limiter.Feedback(milliseconds(1000), false);
+    CHECK_EQ(limiter.getRate(), rate * 0.5);
+    CHECK_EQ(limiter.getDecreases(), 1u);
+}
+
+TEST(adaptive_rate_follows_latency_shift) {
+    AdaptiveRateLimiter limiter(10.0, 1.0, 100.0);
+    limiter.SetDecrease(0.5, milliseconds(0));
+
+    for(int i = 0; i < 30; i++) limiter.Feedback(milliseconds(50), false);
+    /// Latency is higher for good: spikes at first, then the new normal the rate grows on again
+    for(int i = 0; i < 500; i++) limiter.Feedback(milliseconds(400), false);
+    CHECK(limiter.getBaseline() > 300.0);
+    CHECK(limiter.getRate() > 10.0);
+}
+
+TEST(adaptive_rate_bounds_clamped) {
+    AdaptiveRateLimiter limiter(0.0, 0.0, 10.0);
+    CHECK(limiter.getRate() > 0.0);
+
+    limiter.Feedback(milliseconds(10), false);
+    CHECK(limiter.getRate() > 0.0 && limiter.getRate() <= 10.0);
+
+    AdaptiveRateLimiter above(50.0, 1.0, 10.0);
+    CHECK_EQ(above.getRate(), 10.0);
+}
@@ -0,0 +1,89 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "response.hpp"
+
+using namespace vk;
+
+static const JsonBackend backends[] = { JSON_BACKEND_JSONCPP, JSON_BACKEND_ARENA, JSON_BACKEND_VIEW };
+
+static const string document =
+    "{\"response\": {\"count\": 2, \"items\": ["
+    "{\"id\": 1, \"name\": \"Pavel\", \"rate\": 4.5, \"online\": true, \"city\": null, \"tags\": [1, 2, 3]},"
+    "{\"id\": 9223372036854775807, \"name\": \"\\u0410\\\\n\", \"rate\": 1e300, \"online\": false, \"city\": {\"id\": -2}, \"tags\": []}"
+    "], \"big\": 18446744073709551615, \"fraction\": -2.75}}";
+
+/// Same answers from every accessor, recursively
+static bool same(const ResponseValue& a, const ResponseValue& b) {
+    if(a.type() != b.type() || a.size() != b.size()) return false;
+    if(!a.exists()) return true;
+    if(a.asBool() != b.asBool() || a.asInt(-1) != b.asInt(-1) || a.asInt64(-1) != b.asInt64(-1)) return false;
+    if(a.asUInt64(1) != b.asUInt64(1) || a.asID(-1) != b.asID(-1) || a.asDouble() != b.asDouble()) return false;
+    if(a.asString("-") != b.asString("-") || a.toValue() != b.toValue()) return false;
+
+    /// Members are walked in document order or sorted by name depending on the backend
+    size_t members = 0;
+    for(ResponseValue::Iterator it = a.begin(); it != a.end(); ++it, ++members) {
+        const string name = it.name();
+        if(a.isObject() && !same(*it, b[StringRef(name)])) return false;
+    }
+    if(members != a.size()) return false;
+
+    for(size_t i = 0; i < a.size(); i++) {
+        if(!same(a[i], b[i])) return false;
+    }
+    return !a[a.size()].exists() && !b[b.size()].exists();
+}
+
+TEST(response_backend_parity) {
+    Response reference(JSON_BACKEND_JSONCPP);
+    CHECK(reference.Parse(document));
+
+    for(JsonBackend backend : backends) {
+        Response response(backend);
+        CHECK(response.Parse(document));
+        CHECK_EQ(response.getBackend(), backend);
+        CHECK(same(response.getRoot(), reference.getRoot()));
+
+        ResponseValue items = response.getRoot()["response"]["items"];
+        CHECK_EQ(items.size(), 2u);
+        CHECK_EQ(items[1]["id"].asInt64(), INT64_MAX);
+        CHECK_EQ(items[1]["rate"].asInt(7), 7);
+        CHECK_EQ(items[1]["city"]["id"].asInt(), -2);
+        CHECK_EQ(response.getRoot()["response"]["big"].asUInt64(), UINT64_MAX);
+        CHECK_EQ(response.getRoot()["response"]["big"].asInt64(5), 5);
+        CHECK_EQ(response.getRoot()["response"]["fraction"].asInt(), -2);
+        CHECK(!items[2].exists());
+        CHECK(!response.getRoot()["missing"]["deeper"].exists());
+    }
+}
+
+TEST(response_backend_errors) {
+    for(JsonBackend backend : backends) {
+        Response response(backend);
+        CHECK(!response.Parse("{\"response\": [1, 2"));
+        CHECK(!response.getError().empty());
+        CHECK(!response.getRoot().exists());
+
+        /// Next parse starts clean
+        CHECK(response.Parse("[1]"));
+        CHECK(response.getError().empty());
+        CHECK_EQ(response.getRoot()[0].asInt(), 1);
+    }
+}
+
+TEST(response_backend_switch) {
+    Response response(JSON_BACKEND_ARENA);
+    CHECK(response.Parse("{\"a\": 1}"));
+
+    /// Current response keeps its backend until the next parse
+    response.SetBackend(JSON_BACKEND_VIEW);
+    CHECK_EQ(response.getBackend(), JSON_BACKEND_ARENA);
+    CHECK_EQ(response.getConfiguredBackend(), JSON_BACKEND_VIEW);
+    CHECK_EQ(response.getRoot()["a"].asInt(), 1);
+
+    CHECK(response.Parse("{\"a\": 2}"));
+    CHECK_EQ(response.getBackend(), JSON_BACKEND_VIEW);
+    CHECK_EQ(response.getRoot()["a"].asInt(), 2);
+}
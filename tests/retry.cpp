@@ -0,0 +1,86 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#include "test.hpp"
+#include "vkapi.hpp"
+#include "retry.hpp"
+
+using namespace vk;
+
+/// Policy without a budget, so classification alone decides
+static RetryPolicy unlimited() {
+    RetryPolicy policy;
+    policy.SetBudget(nullptr);
+    return policy;
+}
+
+TEST(retry_curl_codes) {
+    RetryPolicy policy = unlimited();
+
+    /// Nothing was sent: safe for any method
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_RESOLVE_HOST, 0));
+
+    /// VK may have executed the request: reads only
+    for(CURLcode code : {CURLE_OPERATION_TIMEDOUT, CURLE_RECV_ERROR, CURLE_SEND_ERROR, CURLE_GOT_NOTHING}) {
+        CHECK(!policy.ShouldRetry(code, 0, false));
+        CHECK(policy.ShouldRetry(code, 0, true));
+    }
+
+    CHECK(!policy.ShouldRetry(CURLE_URL_MALFORMAT, 0, true));
+}
+
+TEST(retry_vk_codes) {
+    RetryPolicy policy = unlimited();
+
+    CHECK(policy.ShouldRetry(RESULT_TOO_MANY_REQUESTS, 0));
+    CHECK(policy.ShouldRetry(RESULT_TOO_MANY_SIMILAR_REQUESTS, 0));
+    CHECK(!policy.ShouldRetry(RESULT_INTERNAL_ERROR, 0, false));
+    CHECK(policy.ShouldRetry(RESULT_INTERNAL_ERROR, 0, true));
+    CHECK(!policy.ShouldRetry(RESULT_AUTORIZATION_ERROR, 0, true));
+}
+
+TEST(retry_max_retries) {
+    RetryPolicy policy = unlimited();
+    policy.SetMaxRetries(2);
+
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_CONNECT, 1));
+    CHECK(!policy.ShouldRetry(CURLE_COULDNT_CONNECT, 2));
+}
+
+TEST(retry_budget) {
+    /// No time based refill, a retry per four requests, two retries saved at most
+    std::shared_ptr<RetryBudget> budget = std::make_shared<RetryBudget>(0.25, 0.0, 2.0);
+    RetryPolicy policy;
+    policy.SetBudget(budget);
+
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+    CHECK(!policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+
+    /// Unretryable codes don't spend it
+    for(int i = 0; i < 4; i++) policy.OnRequest();
+    CHECK(!policy.ShouldRetry(CURLE_URL_MALFORMAT, 0));
+    CHECK(policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+    CHECK(!policy.ShouldRetry(CURLE_COULDNT_CONNECT, 0));
+
+    for(int i = 0; i < 100; i++) budget->Deposit();
+    CHECK_EQ(budget->getBalance(), 2.0);
+}
+
+TEST(retry_backoff_bounds) {
+    RetryPolicy policy;
+    policy.SetBackoff(milliseconds(100), milliseconds(1000));
+
+    for(size_t attempt = 0; attempt < 40; attempt++) {
+        const milliseconds cap = std::min(milliseconds(100 << std::min<size_t>(attempt, 20)), milliseconds(1000));
+        for(int i = 0; i < 50; i++) {
+            milliseconds delay = policy.Backoff(attempt);
+            CHECK(delay.count() >= 0 && delay <= cap);
+        }
+    }
+
+    /// Floor wins over jitter, e.g. the server asked to slow down
+    for(int i = 0; i < 50; i++) CHECK(policy.Backoff(0, milliseconds(500)) >= milliseconds(500));
+}
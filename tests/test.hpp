@@ -0,0 +1,41 @@
+/* Copyright (c) 2016 Mike Lubinets (aka mersinvald)
+ * See LICENSE */
+
+#ifndef VKAPI_TEST_HPP
+#define VKAPI_TEST_HPP
+
+#include <vector>
+#include <string>
+
+/// Minimal unit test harness: TEST(name) { CHECK(...); } anywhere in the sources,
+/// main() runs every registered case and fails if any check did.
+namespace test {
+
+typedef void (*Function)();
+
+struct Case {
+    const char* name;
+    Function    function;
+};
+
+std::vector<Case>& cases();
+void Fail(const char* file, int line, const std::string& what);
+
+struct Registrar {
+    Registrar(const char* name, Function function) { cases().push_back(Case{name, function}); }
+};
+
+}
+
+#define TEST(name)                                                          \
+    static void test_##name();                                              \
+    static test::Registrar registrar_##name(#name, test_##name);            \
+    static void test_##name()
+
+#define CHECK(condition)                                                    \
+    do { if(!(condition)) test::Fail(__FILE__, __LINE__, #condition); } while(0)
+
+#define CHECK_EQ(actual, expected)                                          \
+    CHECK((actual) == (expected))
+
+#endif // VKAPI_TEST_HPP